@@ -11,7 +11,8 @@
 #define G4VIS_USE 1
 
 #include "G4RunManager.hh"
-//#include "G4MTRunManager.hh"
+#include "G4RunManagerFactory.hh"
+#include "G4Threading.hh"
 
 #include "FTFP_BERT.hh"
 #include "G4UImanager.hh"
@@ -19,14 +20,18 @@
 #include "QGSP_BIC.hh"
 #include "XrayFluoPhysicsList.hh"
 // FTFP_BERT.hh"
+#include "ActionInitialization.hh"
 #include "AnalysisManager.hh"
 #include "DetectorConstruction.hh"
+#include "ImportanceParallelWorld.hh"
 #include "EventAction.hh"
 #include "G4PhysListFactory.hh"
 #include "G4VModularPhysicsList.hh"
-#include "PrimaryGeneratorAction.hh"
-#include "RunAction.hh"
-#include "SteppingAction.hh"
+#include "PhaseSpaceSource.hh"
+#include "SpectrumSampler.hh"
+#include "TROOT.h"
+#include "stdlib.h"
+#include <sstream>
 #include "time.h"
 
 //#ifdef G4VIS_USE
@@ -48,13 +53,48 @@ void Help() {
          << "                     The structure of the root file is defined in "
             "t2sim.h ."
          << G4endl
+         << "                     Several files or patterns can be given, "
+            "separated by commas. Entry N is the primary of global event N, "
+            "energies are in keV, positions in mm."
+         << G4endl
          << " -k        [grids|pix ]   kill tracks in the grids or pixels"
          << G4endl << G4endl
-         << " -s                 spec.csv.   The CSV file defined the energy "
-            "spectrum"
+         << " -s                 spec.root[:hname]  Sample the energies of the"
+            " GPS primaries from a TH1 (keV), the first TH1 of the file by"
+            " default"
+         << G4endl << G4endl << " --phsp FILES"<<"  Replay the phsp trees of"
+            " the files (comma separated, patterns allowed)"
+         << G4endl << G4endl << " --phsp-uses N"<<"  Use every phase space"
+            " record in N >= 1 events, with its weight divided by N"
+         << G4endl << G4endl << " --phsp-rotate"<<"  Rotate the replayed"
+            " records randomly around the z axis (symmetric setups only)"
+         << G4endl << G4endl << " --spectrum-interpolation"<<"  Sample the"
+            " energy linearly inside the bins of the -s spectrum"
          << G4endl << G4endl << " -qgsp               Use QGSP_EMX model"
          << G4endl << G4endl << " --gui"<<"     Enable GUI"
          << G4endl << G4endl << " --Ba133  "<<" Enable Ba133 radiation source"
+         << G4endl << G4endl << " --line-source NAME"<<"  Radionuclide source"
+            " with the lines of data/NAME.dat (Ba133, Am241, Cd109) or a .dat"
+            " file"
+         << G4endl << G4endl << " --threads N"<<"  Number of worker threads,"
+            " outputs are merged into OUTPUT at the end of each run"
+         << G4endl << G4endl << " --seed S"<<"  Run seed, events are seeded"
+            " from (S, event ID). Default: current time"
+         << G4endl << G4endl << " --event-offset N"<<"  Offset added to event"
+            " IDs, used to split a campaign into shards"
+         << G4endl << G4endl << " --raytrace N"<<"  Trace N >= 1 straight GPS"
+            " rays per event and fill the uncollided transmission into h2xy"
+         << G4endl << G4endl << " --response N,EMIN,EMAX"<<"  Fill E0 vs"
+            " deposited and recorded energy matrices of every pixel online,"
+            " N bins from EMIN to EMAX keV on both axes, e.g. 300,0,150;"
+            " not with --line-source, --Ba133 or --phsp"
+         << G4endl << G4endl << " --aperture-bias F"<<"  Sample the fraction F"
+            " (0 <= F < 1) of the GPS positions over the slit apertures,"
+            " with weights"
+         << G4endl << G4endl << " --save-events"<<"  Fill the events tree"
+            " for the events with deposits, input of g4analysis"
+         << G4endl << G4endl << " --save-hits"<<"  Fill the hits tree with"
+            " the raw pixel deposits, input of g4redigi"
 		//} else if (sel == "--gui") {
 		//} else if (sel == "--gui") {
          << G4endl << " -h                  print help information" << G4endl;
@@ -65,12 +105,26 @@ int main(int argc, char **argv) {
   G4String macFilename;
   G4String particleSourceType = "";
   G4String particleSourceFile = "";
+  G4String inputFile = "";
+  G4bool spectrumInterpolation = false;
+  G4String phspFiles = "";
+  G4int phspUses = 1;
+  G4bool phspRotate = false;
   G4bool gui = false;
 
   if (argc == 1)
     Help();
 
   G4String trackKilledVolumn="";
+  G4int nThreads = 1;
+  G4long seed = time(NULL);
+  G4long eventOffset = 0;
+  G4int numRays = 0;
+  G4double apertureBias = 0;
+  G4bool saveEvents = false;
+  G4bool saveHits = false;
+  G4int responseBins = 0;
+  G4double responseMin = 0, responseMax = 0;
   int s = 0;
   bool useQGSP = false;
   G4String sel;
@@ -87,55 +141,187 @@ int main(int argc, char **argv) {
       return 0;
 
     } else if (sel == "-o") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
       outputFilename = argv[++s];
       if (!outputFilename.contains(".root")) {
         Help();
-        return 0;
+        return 1;
       }
     } else if (sel == "-m") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
       macFilename = argv[++s];
       if (!macFilename.contains(".mac")) {
         Help();
-        return 0;
+        return 1;
+      }
+    } else if (sel == "-i") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
       }
+      inputFile = argv[++s];
     } else if (sel == "-s") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
       particleSourceFile = argv[++s];
       if (!particleSourceFile.contains(".root")) {
         Help();
-        return 0;
+        return 1;
       }
     }
 
     else if (sel == "-k") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
       trackKilledVolumn = argv[++s];
 
 
+    } else if (sel == "--phsp" || sel == "--phsp-uses") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      if (sel == "--phsp") {
+        phspFiles = argv[++s];
+      } else {
+        phspUses = atoi(argv[++s]);
+        if (phspUses < 1) {
+          G4cout << "The phase space uses must be at least 1" << G4endl;
+          Help();
+          return 1;
+        }
+      }
+    } else if (sel == "--phsp-rotate") {
+      phspRotate = true;
+    } else if (sel == "--spectrum-interpolation") {
+      spectrumInterpolation = true;
     } else if (sel == "--gui") {
       gui = true;
     } else if (sel == "--qgsp") {
       useQGSP = true;
+    } else if (sel == "--threads") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      nThreads = atoi(argv[++s]);
+      if (nThreads < 1) {
+        nThreads = G4Threading::G4GetNumberOfCores();
+      }
+    } else if (sel == "--seed" || sel == "--event-offset") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      G4long value = atol(argv[++s]);
+      if (sel == "--seed") {
+        seed = value;
+      } else {
+        eventOffset = value;
+      }
+    } else if (sel == "--raytrace") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      numRays = atoi(argv[++s]);
+      if (numRays < 1) {
+        G4cout << "The number of rays must be at least 1" << G4endl;
+        Help();
+        return 1;
+      }
+    } else if (sel == "--response") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      char comma1, comma2;
+      std::istringstream spec(argv[++s]);
+      if (!(spec >> responseBins >> comma1 >> responseMin >> comma2 >>
+            responseMax) ||
+          comma1 != ',' || comma2 != ',' || responseBins <= 0 ||
+          responseMax <= responseMin) {
+        G4cout << "Invalid response binning: " << argv[s] << G4endl;
+        return 1;
+      }
+    } else if (sel == "--save-events") {
+      saveEvents = true;
+    } else if (sel == "--save-hits") {
+      saveHits = true;
+    } else if (sel == "--aperture-bias") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      apertureBias = atof(argv[++s]);
+      if (apertureBias < 0 || apertureBias >= 1) {
+        G4cout << "The aperture bias fraction must be in [0, 1)" << G4endl;
+        return 1;
+      }
+    } else if (sel == "--line-source") {
+      if (s + 1 >= argc) {
+        Help();
+        return 1;
+      }
+      particleSourceType = argv[++s];
     } else if (sel == "--Ba133") {
       particleSourceType = "Ba133";
       /*if(!particleSourceType.contains(".root"))
         {
         Help();
-        return 0;
+        return 1;
         }
         */
     }
 	else{
 		G4cout<<"Can not understand option :"<<sel<<G4endl;
 		Help();
-		return 0;
+		return 1;
 	}
   }
 
-  time_t DateTime = time(NULL);
-  CLHEP::HepRandom::setTheSeed(DateTime);
+  // the matrices are filled against the energy of the first primary
+  if (responseBins > 0 && (particleSourceType != "" || phspFiles != "")) {
+    G4cout << "--response needs one primary per event, it can not be used "
+              "with --line-source, --Ba133 or --phsp"
+           << G4endl;
+    return 1;
+  }
+
+  CLHEP::HepRandom::setTheSeed(seed);
+  G4cout << ">>Random seed: " << seed << ", event ID offset: " << eventOffset
+         << G4endl;
 
   AnalysisManager *analysisManager = AnalysisManager::GetInstance();
   // CLHEP::HepRandom::setTheEngine(new CLHEP::RanecuEngine);
   analysisManager->SetOutputFileName(outputFilename);
+  analysisManager->SetRandomSeed(seed);
+  analysisManager->SetEventIDOffset(eventOffset);
+  analysisManager->SetResponseBinning(responseBins, responseMin, responseMax);
+  if (saveEvents)
+    analysisManager->SaveEvents();
+  if (saveHits)
+    analysisManager->SaveHits();
+  Long64_t numFirstStageEvents = -1;
+  if (phspFiles != "") {
+    numFirstStageEvents = PhaseSpaceSource::CountFirstStageEvents(phspFiles);
+    if (numFirstStageEvents < 0) {
+      G4cout << "The first stage events of " << phspFiles
+             << " are unknown, the replay can not be normalized" << G4endl;
+    }
+    analysisManager->SetPhaseSpaceInput(phspFiles, numFirstStageEvents,
+                                        phspUses);
+  }
 
   if (trackKilledVolumn.contains("grids")) {
 	  G4cout<<">>Tracks will be killed in grids..."<<G4endl;
@@ -147,20 +333,26 @@ int main(int argc, char **argv) {
   }
   analysisManager->SetCommandLine(commandLine);
 
-  //#ifdef G4MULTITHREADED
-  /*
-     G4MTRunManager * runManager = new G4MTRunManager();
-     G4int nThreads = G4Threading::G4GetNumberOfCores()-2;
-     if(nThreads<1)nThreads=1;
-     runManager->SetNumberOfThreads(nThreads);
-     */
-  //#else
-  G4RunManager *runManager = new G4RunManager();
-  //#endif
+  G4RunManager *runManager = NULL;
+  if (nThreads > 1) {
+    // each worker fills its own AnalysisManager, the master merges the
+    // outputs at the end of the run
+    ROOT::EnableThreadSafety();
+    runManager = G4RunManagerFactory::CreateRunManager(
+        G4RunManagerType::Tasking, nThreads, false);
+    G4cout << ">>Running with " << runManager->GetNumberOfThreads()
+           << " threads" << G4endl;
+  } else {
+    runManager =
+        G4RunManagerFactory::CreateRunManager(G4RunManagerType::Serial);
+  }
 
   DetectorConstruction *detConstruction = new DetectorConstruction();
 
   G4cout << "Initializing detector" << G4endl;
+  // importance cells, only built and used with /det/importance/layers
+  detConstruction->RegisterParallelWorld(new ImportanceParallelWorld(
+      ImportanceParallelWorld::GetDefaultName(), detConstruction));
   runManager->SetUserInitialization(detConstruction);
   G4cout << "Initializing physicslist" << G4endl;
   //    G4VUserPhysicsList* physics = new QGSP_BIC;
@@ -178,25 +370,39 @@ int main(int argc, char **argv) {
     runManager->SetUserInitialization(new XrayFluoPhysicsList());
   }
 
-  G4cout << "Initializing primary generation" << G4endl;
-  PrimaryGeneratorAction *primarygen = new PrimaryGeneratorAction();
-  runManager->SetUserAction(primarygen);
-  if (particleSourceType != "") {
-    primarygen->SetParticleSource(particleSourceType);
-  }
+  G4cout << "Initializing user actions" << G4endl;
+  ActionInitialization *actionInit = new ActionInitialization();
+  actionInit->SetParticleSource(particleSourceType);
   if (particleSourceFile != "") {
-    primarygen->InitParticleSpectrumFromROOT(particleSourceFile);
-    // primarygen->SetParticleSource(particleSourceType);
+    // loaded once, the threads share it
+    SpectrumSampler *spectrum = new SpectrumSampler();
+    if (!spectrum->Load(particleSourceFile)) {
+      return 1;
+    }
+    spectrum->SetInterpolation(spectrumInterpolation);
+    actionInit->SetSpectrumSampler(spectrum);
   }
-  G4cout << "Set particle type:" << particleSourceType << G4endl;
-
-  G4cout << "Initializing run action" << G4endl;
-  runManager->SetUserAction(new RunAction());
-  EventAction *evtAction = new EventAction();
-  G4cout << "Initializing event action" << G4endl;
-  runManager->SetUserAction(evtAction);
-  G4cout << "Initializing stepping action" << G4endl;
-  runManager->SetUserAction(new SteppingAction());
+  actionInit->SetRaytrace(numRays);
+  actionInit->SetApertureBias(apertureBias);
+  actionInit->SetInputFile(inputFile);
+  if (phspFiles != "") {
+    // one pass over the records on the master, the threads share the index,
+    // which the action initialization deletes
+    std::vector<Long64_t> *phspHistories = new std::vector<Long64_t>();
+    if (!PhaseSpaceSource::BuildHistoryIndex(phspFiles, *phspHistories)) {
+      G4cout << "Can not read the phase space records of " << phspFiles
+             << G4endl;
+      return 1;
+    }
+    G4cout << "Replaying " << phspHistories->back()
+           << " phase space records of " << phspHistories->size() - 1
+           << " events from " << phspFiles << ", " << phspUses
+           << " uses per event, " << numFirstStageEvents
+           << " first stage events" << G4endl;
+    actionInit->SetPhaseSpaceInput(phspFiles, phspHistories, phspUses,
+                                   phspRotate);
+  }
+  runManager->SetUserInitialization(actionInit);
 
   //#ifdef G4VIS_USE
   G4VisManager *visManager = NULL;
@@ -224,9 +430,9 @@ int main(int argc, char **argv) {
   if (visManager)
     delete visManager;
 
-  // delete runManager;
   delete ui;
-  delete UImanager;
+  // the run manager deletes the user initializations and the UI manager
+  delete runManager;
   G4cout << "Output filename: " << outputFilename << G4endl;
 
   return 0;
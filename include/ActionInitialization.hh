@@ -0,0 +1,53 @@
+//
+/// \file ActionInitialization.hh
+/// \brief Definition of the ActionInitialization class
+
+#ifndef ActionInitialization_h
+#define ActionInitialization_h 1
+
+#include <vector>
+
+#include "G4VUserActionInitialization.hh"
+#include "Rtypes.h"
+#include "globals.hh"
+
+class SpectrumSampler;
+
+// creates the user actions for the master and for each worker thread
+class ActionInitialization : public G4VUserActionInitialization {
+public:
+  ActionInitialization();
+  virtual ~ActionInitialization();
+
+  virtual void BuildForMaster() const;
+  virtual void Build() const;
+
+  void SetParticleSource(G4String val) { particleSource = val; }
+  void SetSpectrumSampler(const SpectrumSampler *val) { spectrum = val; }
+  // rays traced per event, 0 for normal tracking
+  void SetRaytrace(G4int raysPerEvent) { numRays = raysPerEvent; }
+  void SetInputFile(G4String val) { inputFile = val; }
+  // fraction of the GPS primaries sampled over the slit apertures
+  void SetApertureBias(G4double val) { apertureBias = val; }
+  // the history index of the files is shared by the threads and deleted
+  // with the action initialization
+  void SetPhaseSpaceInput(G4String files,
+                          const std::vector<Long64_t> *historyStart,
+                          G4int numUses, G4bool rotate) {
+    phspFiles = files;
+    phspHistories = historyStart;
+    phspUses = numUses;
+    phspRotate = rotate;
+  }
+
+private:
+  G4String particleSource, inputFile, phspFiles;
+  const std::vector<Long64_t> *phspHistories;
+  G4int phspUses;
+  G4bool phspRotate;
+  const SpectrumSampler *spectrum;
+  G4int numRays;
+  G4double apertureBias;
+};
+
+#endif
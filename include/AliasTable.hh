@@ -0,0 +1,36 @@
+//
+/// \file AliasTable.hh
+/// \brief Definition of the AliasTable class
+
+#ifndef AliasTable_h
+#define AliasTable_h 1
+
+#include <vector>
+
+// Walker's alias method: samples an index with probability proportional to
+// its weight in constant time, from a single uniform number. Plain C++, it
+// is shared by g4main and the command line tools.
+class AliasTable {
+public:
+  AliasTable() {}
+  explicit AliasTable(const std::vector<double> &weights) { Build(weights); }
+
+  void Build(const std::vector<double> &weights);
+  int GetSize() const { return fProb.size(); }
+
+  // u is uniform in [0, 1)
+  int Sample(double u) const {
+    int n = fProb.size();
+    double x = u * n;
+    int i = (int)x;
+    if (i >= n)
+      i = n - 1;
+    return x - i < fProb[i] ? i : fAlias[i];
+  }
+
+private:
+  std::vector<double> fProb;
+  std::vector<int> fAlias;
+};
+
+#endif
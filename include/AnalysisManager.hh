@@ -5,6 +5,7 @@
 #ifndef AnalysisManager_h
 #define AnalysisManager_h 1
 
+#include <map>
 #include <vector>
 
 #include "globals.hh"
@@ -13,46 +14,101 @@
 //#include "G4Event.hh"
 //#include "G4Run.hh"
 #include "G4ThreeVector.hh"
+#include "OutputLayout.hh"
 #include "TString.h"
 
-#define NUM_CHANNELS 12 
+#define NUM_CHANNELS NUM_PIXELS
 class G4Run;
 class G4Event;
 class G4Step;
+class G4Track;
 
 class TCanvas;
+class TH1D;
 class TH1F;
 class TH2F;
 class TFile;
 class TTree;
+class TRandom3;
+class DetectorResponse;
 const int MAX_TRACKS = 30;
 
 class AnalysisManager {
 public:
+  // one instance per thread; the instance of the master thread holds the
+  // configuration and merges the outputs of the workers in MT mode
   static AnalysisManager *GetInstance();
   static void Dispose();
 
   void CloseROOT();
-  void SetEventID(G4int eventid) { eventID = eventid; }
+  void SetEventID(G4int eventid) { eventID = GetGlobalEventID(eventid); }
   void SetOutputFileName(TString filen) { outputFilename = filen; }
 
+  // seeding: each event gets its own random streams derived from the run
+  // seed and the global event ID, independent of threads or processes
+  void SetRandomSeed(G4long seed) { randomSeed = seed; }
+  G4long GetRandomSeed() const { return randomSeed; }
+  void SetEventIDOffset(G4long offset) { eventIDOffset = offset; }
+  G4long GetGlobalEventID(G4int eventid) const {
+    return eventIDOffset + eventid;
+  }
+  void SeedEvent(G4int eventid);
+
   void SetCommandLine(G4String s) { commandLine = s; }
   void InitEvent(const G4Event *event);
-  void UpdateParticleGunInfo();
+  void UpdatePrimaryInfo(const G4Event *event);
   void ProcessEvent(const G4Event *event);
-  void ProcessStep(const G4Step *aStep);
+  void ProcessDetectorPlaneHit(const G4Step *aStep);
   void InitRun(const G4Run *);
+  // called for every track before it is tracked; in importance split runs
+  // the deposits are grouped by the split copy the track descends from
+  void BeginTrack(const G4Track *track);
   void ProcessRun(const G4Run *);
+  void MergeWorkerOutputs();
 
   //void RegisterDummyDetector(){isDummyDetector=true;}
-  void AddEnergy(G4int detId, G4double edep);
+  // weight: of the track that deposited the energy
+  void AddEnergy(G4int detId, G4double edep, G4double weight);
   void AddCollectedEnergy(G4int detId, G4double edep);
+  // energy deposit of a step in a pixel for the hits tree, depth in mm,
+  // edep in keV, time in ns
+  void RecordHit(G4int detId, G4double depth, G4double edep, G4double time,
+                 G4double weight);
   void CopyMacrosToROOT(TFile *f, TString &);
-  G4double ComputeCollectionEfficiency(G4ThreeVector &pos);
-  G4double GetNearSurfaceFactor(G4ThreeVector &pos);
+  // depth from the cathode, in units of mm, the weight of the track is used
+  // for the histograms
+  G4double ComputeCollectionEfficiency(G4double depth, G4double weight);
+  G4double GetNearSurfaceFactor(G4double depth, G4double weight);
   G4double GetEnergyResolution(G4double Ek);
   void SetMacroFileName(G4String &name) { macroFilename = name; }
 void FillDetectorIncidentParticle(const G4Step *aStep);
+  // hit map of the detector plane in its x and y, also filled by the ray
+  // tracing
+  void FillDetectorMap(const G4ThreeVector &pos, G4double weight);
+  // particles entering the phase space plane, written to the phsp tree
+  void FillPhaseSpace(const G4Step *aStep);
+  // E0 vs deposited and E0 vs recorded energy matrices of each pixel and
+  // of their sum, filled online for the events above the threshold;
+  // nbins = 0 disables them
+  void SetResponseBinning(G4int nbins, G4double emin, G4double emax) {
+    responseBins = nbins;
+    responseMin = emin;
+    responseMax = emax;
+  }
+  // fill the events tree for the events with deposits, the input of
+  // g4analysis; off by default as the tree is large
+  void SaveEvents() { saveEvents = true; }
+  // fill the hits tree with the raw energy deposits of every event, to be
+  // digitized again by g4redigi with other detector parameters
+  void SaveHits() { saveHits = true; }
+  // phsp input of a second stage run and the events of its first stage,
+  // -1 if unknown, recorded in the metadata
+  void SetPhaseSpaceInput(const G4String &files, Long64_t numEvents,
+                          G4int numUses) {
+    phspInputFiles = files;
+    phspInputEvents = numEvents;
+    phspInputUses = numUses;
+  }
   void KillTracksInGrids() {
     killTracksEnteringGrids = true;
     G4cout << "# Tracks entering Grids will be killed" << G4endl;
@@ -66,19 +122,26 @@ void FillDetectorIncidentParticle(const G4Step *aStep);
   ~AnalysisManager();
 
 private:
-  static AnalysisManager *fManager;
+  void CopyConfiguration(const AnalysisManager *master);
+  G4bool IsMergingMaster() const;
+
+  static G4ThreadLocal AnalysisManager *fManager;
+  static AnalysisManager *fMasterManager;
+  static std::vector<TString> fWorkerFiles;
 
   TString outputFilename;
+  TString threadOutputFilename;
   TString macroFilename;
   G4int numInpTreeFilled;
-  G4int numSourceTreeFilled;
   G4int numPhysTreeFilled;
   G4int boundary;
   //G4bool isDummyDetector;
 
-  G4bool isNewEvent;
-
   TFile *rootFile;
+  TRandom3 *fRandom; // digitization, one generator per thread
+  DetectorResponse *fResponse;
+  // near surface parameters of the event in DEBUG mode, per thread
+  G4double debugNearSurfaceR0, debugNearSurfaceL;
   TTree *evtTree;
   TTree *inpTree;
   TTree *physTree;
@@ -95,11 +158,13 @@ private:
 
   G4double inpPos[3];
   G4double inpVec[3];
-  G4double inpEnergy, inpTheta;
+  G4double inpEnergy, inpTheta, inpWeight;
 
   G4double gunPosition[3];
   G4double gunDirection[3];
   G4double gunEnergy;
+  G4int numPrimaries;
+  G4double eventWeight; // weight of the primary vertex
   TCanvas *c1;
   TH1F *hd[NUM_CHANNELS];
   TH1F *hEdepSum;
@@ -128,7 +193,29 @@ private:
   // energy spectrum with single hit only
 
   TH2F *h2xy;
+  G4int responseBins;
+  G4double responseMin, responseMax;
+  TH1F *hResponseE0; // all primaries, to normalize the matrices
+  // events of the run, summed by the merging; the normalization of the
+  // phsp replays
+  TH1D *hNumEvents;
+  G4String phspInputFiles;
+  Long64_t phspInputEvents;
+  G4int phspInputUses;
+  TH2F *hResponseEdep[NUM_CHANNELS + 1]; // the last one is the pixel sum
+  TH2F *hResponseReal[NUM_CHANNELS + 1];
+  void BookResponseMatrices();
+  void FillResponseMatrices();
+  // digitizes the pixel sums and fills the pixel outputs, once per event,
+  // or once per split copy in importance split runs
+  void FillPixelSums();
   TTree *primTree;
+  TTree *phspTree;
+  Int_t phspPDG;
+  Float_t phspEnergy;
+  Float_t phspPos[3];
+  Float_t phspDir[3];
+  Float_t phspWeight;
   G4int numKilled;
 
   G4double sci[NUM_CHANNELS];
@@ -137,9 +224,37 @@ private:
   G4double collectedEnergySum[NUM_CHANNELS];
   G4double edepWithoutNoise[NUM_CHANNELS];
   G4double collectedEdepSumRealistic[NUM_CHANNELS];
+  G4double edepWeightSum[NUM_CHANNELS];
+  G4double channelWeight[NUM_CHANNELS];
   G4int nHits[32];
-  G4int eventID;
+  Long64_t eventID; // global event ID, including the offset of the shard
+  G4long randomSeed;
+  G4long eventIDOffset;
   G4bool killTracksEnteringGrids, killTracksEnteringDetectors;
+  G4bool saveEvents;
+  G4bool saveHits;
+  // the split copies of a history are independent realizations of its
+  // rest, each copy gets its own pixel sums, digitized and counted with
+  // the weights of its tracks
+  G4bool importanceSplitting;
+  struct CopySums {
+    G4double edep[NUM_CHANNELS];
+    G4double collected[NUM_CHANNELS];
+    G4double edepWeight[NUM_CHANNELS];
+  };
+  std::map<G4int, G4int> trackCopy;     // split copy of each track ID
+  std::map<G4int, CopySums> copySums;   // by the track ID of the copy
+  G4int currentCopy;                    // of the track being tracked
+  G4int rawCopy[MAX_HITS];              // not stored, see FillPixelSums
+  TTree *hitsTree;
+  Int_t numHits;
+  Long64_t numHitsDropped; // beyond MAX_HITS in an event
+  Bool_t hitsTruncated;    // hits of this event dropped
+  Short_t rawPixel[MAX_HITS];
+  Float_t rawDepth[MAX_HITS];
+  Float_t rawEdep[MAX_HITS];
+  Float_t rawTime[MAX_HITS];
+  Float_t rawWeight[MAX_HITS];
   G4int processType, processSubtype;
 
   G4int parent[MAX_TRACKS];
@@ -0,0 +1,43 @@
+//
+/// \file ApertureSampler.hh
+/// \brief Definition of the ApertureSampler class
+
+#ifndef ApertureSampler_h
+#define ApertureSampler_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+// Biased sampling of the x coordinate of a uniform plane source over the
+// slits of the tungsten plate. A fraction of the primaries is moved to a
+// uniformly chosen point of the slit apertures, projected back to the
+// source along the direction of the primary, the others keep the position
+// of the source. The returned weight is the ratio of the uniform density
+// to this mixture, so the unbiased fraction must stay above 0 to keep the
+// tungsten bars covered.
+class ApertureSampler {
+public:
+  // reads the slit geometry from the detector construction
+  ApertureSampler(G4double biasedFraction);
+  ~ApertureSampler() {}
+
+  // pos is uniform in x over [xMin, xMax] of the source plane, it is
+  // modified in place; returns the statistical weight of the primary
+  G4double Sample(G4ThreeVector &pos, const G4ThreeVector &dir, G4double xMin,
+                  G4double xMax) const;
+
+private:
+  G4double fBiasedFraction;
+  G4double fPitch, fWidth;
+  G4double fFirstCenter; // x of the center of the first slit
+  G4int fNumSlits;
+  G4double fFrontZ; // z of the front face of the plate
+
+  // open length of the slits in [lo, hi] and the range of slits in it
+  G4double GetOpenLength(G4double lo, G4double hi, G4int &first,
+                         G4int &last) const;
+  G4double GetOverlap(G4int i, G4double lo, G4double hi) const;
+  G4bool IsOpen(G4double x) const;
+};
+
+#endif
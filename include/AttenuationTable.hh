@@ -0,0 +1,51 @@
+//
+/// \file AttenuationTable.hh
+/// \brief Definition of the AttenuationTable class
+
+#ifndef AttenuationTable_h
+#define AttenuationTable_h 1
+
+#include <map>
+#include <vector>
+
+#include "globals.hh"
+
+class G4Material;
+
+// Photon attenuation coefficients on a log energy grid, filled from the
+// cross sections of the physics list with G4EmCalculator the first time a
+// material is used. It must only be used after the physics is initialized
+// and is not shared between threads.
+class AttenuationTable {
+public:
+  AttenuationTable(G4double minEnergy, G4double maxEnergy, G4int numPoints);
+  ~AttenuationTable();
+
+  // total attenuation coefficient, 1/length
+  G4double GetAttenuation(const G4Material *mat, G4double energy);
+  // probability that an interaction is a photoabsorption
+  G4double GetPhotoFraction(const G4Material *mat, G4double energy);
+
+  // K fluorescence of the heaviest element of the material: probability
+  // that a photoabsorption above the K edge emits a K alpha photon, and
+  // its energy. Both are 0 below the edge.
+  G4double GetFluorescenceProbability(const G4Material *mat, G4double energy);
+  G4double GetFluorescenceEnergy(const G4Material *mat);
+
+private:
+  struct MaterialData {
+    std::vector<G4double> attenuation;
+    std::vector<G4double> photoFraction;
+    G4double kEdge;
+    G4double kProbability; // K shell fraction times fluorescence yield
+    G4double kAlphaEnergy;
+  };
+  const MaterialData &GetData(const G4Material *mat);
+  G4double Interpolate(const std::vector<G4double> &values, G4double energy);
+
+  G4double fLogMinEnergy, fLogStep;
+  G4int fNumPoints;
+  std::map<const G4Material *, MaterialData> fData;
+};
+
+#endif
@@ -0,0 +1,40 @@
+//
+/// \file CollimatorFastModel.hh
+/// \brief Definition of the CollimatorFastModel class
+
+#ifndef CollimatorFastModel_h
+#define CollimatorFastModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+class AttenuationTable;
+class DetectorConstruction;
+class G4Navigator;
+class G4Region;
+
+// Photons entering the collimator below the configured energy are moved
+// along their straight line through the plate, with the free path sampled
+// from the attenuation of each material on the way. An interacting photon
+// is absorbed, above the K edge it re-emits a K alpha photon isotropically.
+// Scattering is treated as absorption; g4fastcheck compares the spectra
+// transmitted with and without the model (/det/fastsim/enable) to check
+// that this does not matter for a setup.
+class CollimatorFastModel : public G4VFastSimulationModel {
+public:
+  CollimatorFastModel(const G4String &name, G4Region *envelope,
+                      DetectorConstruction *detector);
+  ~CollimatorFastModel();
+
+  G4bool IsApplicable(const G4ParticleDefinition &particle);
+  G4bool ModelTrigger(const G4FastTrack &fastTrack);
+  void DoIt(const G4FastTrack &fastTrack, G4FastStep &fastStep);
+
+private:
+  G4Region *fEnvelope;
+  DetectorConstruction *fDetector;
+  G4Navigator *fNavigator;
+  AttenuationTable *fTable;
+};
+
+#endif
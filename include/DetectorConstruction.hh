@@ -24,6 +24,7 @@ public:
   ~DetectorConstruction();
 
   G4VPhysicalVolume *Construct();
+  void ConstructSDandField();
 
   void SetVisAttrib(G4LogicalVolume *log, G4double red, G4double green,
                     G4double blue, G4double alpha, G4bool wireFrame,
@@ -32,10 +33,44 @@ public:
                     G4double blue, G4double alpha);
   void SetVisColors();
 
+  // tungsten plate with periodic slits
+  void SetPlateDepth(G4double val) { plateHalfDepth = val / 2; }
+  void SetSlitPitch(G4double val) { slitPitch = val; }
+  void SetSlitWidth(G4double val) { slitWidth = val; }
+  G4double GetPlateHalfWidth() const { return plateHalfWidth; }
+  G4double GetPlateHalfDepth() const { return plateHalfDepth; }
+  G4double GetSlitPitch() const { return slitPitch; }
+  G4double GetSlitWidth() const { return slitWidth; }
+  G4int GetNumberOfSlits() const { return numSlits; }
+
+  // the world is cached as GDML in this directory, keyed by a hash
+  void SetGdmlCacheDir(G4String val) { gdmlCacheDir = val; }
+
+  // fast simulation of photons in the collimator, can be changed between
+  // runs
+  void SetFastSimEnabled(G4bool val) { fastSimEnabled = val; }
+  void SetFastSimMaxEnergy(G4double val) { fastSimMaxEnergy = val; }
+  G4bool GetFastSimEnabled() const { return fastSimEnabled; }
+  G4double GetFastSimMaxEnergy() const { return fastSimMaxEnergy; }
+
+  // importance cells in the plate, see ImportanceParallelWorld, 0 layers
+  // disables the biasing
+  void SetImportanceLayers(G4int val) { importanceLayers = val; }
+  void SetImportanceRatio(G4double val) { importanceRatio = val; }
+  G4int GetImportanceLayers() const { return importanceLayers; }
+  G4double GetImportanceRatio() const { return importanceRatio; }
+
+  // phase space scoring plane between the collimator and the detector
+  void SetPhaseSpacePlaneZ(G4double val) {
+    phspZ = val;
+    phspEnabled = true;
+  }
+
 
 private:
 
-  G4String fWorldFile;
+  G4String fWorldFile; // GDML cache of the world
+  G4String gdmlCacheDir;
   G4LogicalVolume *worldLogical, *berylliumWindowLog,*alumWindowLog;
   G4LogicalVolume *padsLogical, *cdTeLogical, *calisteBaseLogical;
   G4Material *CdTe;
@@ -48,7 +83,23 @@ private:
   G4LogicalVolume *ConstructCalisteBase();
   G4LogicalVolume *ConstructCdTe();
   G4AssemblyVolume *ConstructPads();
+  G4LogicalVolume *ConstructTungstenPlate();
+  void DefineMaterials();
+  void ConstructWorld();
+  void ConstructRegions();
+  G4String ComputeGeometryHash();
+  G4bool ReadGeometryCache();
+  void WriteGeometryCache();
   bool checkOverlaps;
+  G4double plateHalfWidth, plateHalfDepth;
+  G4double slitPitch, slitWidth;
+  G4int numSlits;
+  G4bool fastSimEnabled;
+  G4double fastSimMaxEnergy;
+  G4int importanceLayers;
+  G4double importanceRatio;
+  G4bool phspEnabled;
+  G4double phspZ;
   bool isSingleDetector;
 
   // caliste
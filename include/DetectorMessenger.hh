@@ -26,13 +26,20 @@ public:
 
 private:
   DetectorConstruction *fDetector;
-  // G4UIdirectory *fDetectorDir;
+  G4UIdirectory *fDetectorDir;
   G4UIcmdWithABool *fSetAttenStatusCmd;
   G4UIcmdWithABool *fSetGridStatusCmd;
   G4UIcmdWithABool *fSetDetectorStatusCmd, *fSetDetectorSimpleCmd;
-  G4UIcmdWithAString *fSetGdmlCmd;
+  G4UIcmdWithAString *fSetGdmlCmd, *fSetGdmlCacheDirCmd;
   G4UIcmdWithAnInteger *fDetectorSelectionCmd,*fSetGridMaskCmd;
   G4UIcmdWithADoubleAndUnit *fSetGridThicknessCmd;
+  G4UIcmdWithADoubleAndUnit *fSetPlateDepthCmd, *fSetSlitPitchCmd,
+      *fSetSlitWidthCmd;
+  G4UIcmdWithABool *fFastSimEnableCmd;
+  G4UIcmdWithADoubleAndUnit *fFastSimMaxEnergyCmd;
+  G4UIcmdWithADoubleAndUnit *fPhaseSpaceZCmd;
+  G4UIcmdWithAnInteger *fImportanceLayersCmd;
+  G4UIcmdWithADouble *fImportanceRatioCmd;
   // G4UIcmdWithAString *fSetCADTypeCommand;
 };
 
@@ -0,0 +1,23 @@
+//
+/// \file DetectorPlaneSD.hh
+/// \brief Definition of the DetectorPlaneSD class
+
+#ifndef DetectorPlaneSD_h
+#define DetectorPlaneSD_h 1
+
+#include "G4VSensitiveDetector.hh"
+#include "globals.hh"
+
+class G4Step;
+class G4TouchableHistory;
+
+// absorbing detector plane, records incident particles and kills them
+class DetectorPlaneSD : public G4VSensitiveDetector {
+public:
+  DetectorPlaneSD(const G4String &name);
+  virtual ~DetectorPlaneSD();
+
+  virtual G4bool ProcessHits(G4Step *aStep, G4TouchableHistory *history);
+};
+
+#endif
@@ -0,0 +1,62 @@
+//
+/// \file DetectorResponse.hh
+/// \brief Definition of the DetectorResponse class
+
+#ifndef DetectorResponse_h
+#define DetectorResponse_h 1
+
+#include <string>
+
+class TRandom;
+
+// Charge collection and digitization of the CdTe pixels, shared by g4main
+// and g4redigi so that the hits stored by --save-hits can be digitized
+// again offline with other parameters. Energies are in keV, depths in mm
+// from the cathode.
+class DetectorResponse {
+public:
+  // nominal STIX parameters
+  DetectorResponse();
+
+  // parameters by name: fano, enoise (keV), threshold (keV), r0,
+  // l (mm), hv (V); false for unknown names
+  bool SetParameter(const std::string &name, double value);
+  // "name=value", as given to --set; false if it can not be parsed or the
+  // name is unknown
+  bool SetParameter(const std::string &nameEqualsValue);
+  // "name=value" pairs of all parameters
+  std::string Describe() const;
+
+  double GetFanoFactor() const { return fFanoFactor; }
+  double GetNoise() const { return fNoise; }
+  double GetThreshold() const { return fThreshold; }
+  double GetNearSurfaceR0() const { return fNearSurfaceR0; }
+  double GetNearSurfaceL() const { return fNearSurfaceL; }
+
+  // Hecht equation
+  double GetCollectionEfficiency(double depth) const;
+  // charge loss in the damaged layer below the cathode
+  double GetNearSurfaceFactor(double depth) const;
+  // standard deviation of the Fano statistics
+  double GetEnergyResolution(double energy) const;
+  // charge: collected energy smeared with the Fano statistics, charge2:
+  // the recorded energy, with the electronics noise as well
+  void Digitize(double collected, TRandom *random, double &charge,
+                double &charge2) const;
+
+  // per event random streams derived from the run seed and the global
+  // event ID, see AnalysisManager::SeedEvent
+  static unsigned long long GetEventKey(long long runSeed,
+                                        long long eventID);
+  static unsigned long GetDigitizationSeed(long long runSeed,
+                                           long long eventID);
+
+private:
+  double fFanoFactor;
+  double fNoise;
+  double fThreshold;
+  double fNearSurfaceR0, fNearSurfaceL;
+  double fHighVoltage;
+};
+
+#endif
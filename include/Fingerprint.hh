@@ -0,0 +1,19 @@
+//
+/// \file Fingerprint.hh
+/// \brief Content hashes used to key the geometry and physics caches
+
+#ifndef Fingerprint_h
+#define Fingerprint_h 1
+
+#include <ostream>
+#include <string>
+
+#include "globals.hh"
+
+// FNV-1a of the text, as 16 hex digits
+G4String HashToHex(const std::string &text);
+
+// name, density and composition of every material in the material table
+void DescribeMaterials(std::ostream &os);
+
+#endif
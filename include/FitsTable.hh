@@ -0,0 +1,63 @@
+//
+/// \file FitsTable.hh
+/// \brief Minimal writer of FITS binary tables
+
+#ifndef FitsTable_h
+#define FitsTable_h 1
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A FITS binary table extension with 32 bit integer and float columns,
+// fixed (J, E) or variable length (PJ, PE) per row. Only what the OGIP
+// response files need is supported, so the tools don't depend on
+// cfitsio. Values are written big endian, variable length arrays go to
+// the heap after the table.
+class FitsTable {
+public:
+  FitsTable(const std::string &extname, size_t numRows);
+
+  void AddKey(const std::string &key, const std::string &value,
+              const std::string &comment = "");
+  void AddKey(const std::string &key, long value,
+              const std::string &comment = "");
+  void AddKey(const std::string &key, double value,
+              const std::string &comment = "");
+  void AddLogicalKey(const std::string &key, bool value,
+                     const std::string &comment = "");
+
+  // every column must have one entry per row
+  void AddColumn(const std::string &name, const std::string &unit,
+                 const std::vector<int> &values);
+  void AddColumn(const std::string &name, const std::string &unit,
+                 const std::vector<float> &values);
+  void AddColumn(const std::string &name, const std::string &unit,
+                 const std::vector<std::vector<int> > &values);
+  void AddColumn(const std::string &name, const std::string &unit,
+                 const std::vector<std::vector<float> > &values);
+
+  void Write(std::ostream &out) const;
+
+  // a primary HDU without data followed by the tables
+  static bool WriteFile(const std::string &filename,
+                        const std::vector<FitsTable> &tables);
+
+private:
+  struct Column {
+    std::string name, unit;
+    char type;     // 'J' or 'E'
+    bool variable; // P descriptor, the values are in the heap
+    std::vector<std::vector<unsigned int> > data; // raw 32 bit words
+  };
+  std::string fExtname;
+  size_t fNumRows;
+  std::vector<std::string> fKeys; // formatted 80 character cards
+  std::vector<Column> fColumns;
+
+  void AddColumn(const std::string &name, const std::string &unit, char type,
+                 bool variable,
+                 const std::vector<std::vector<unsigned int> > &data);
+};
+
+#endif
@@ -0,0 +1,42 @@
+//
+/// \file ImportanceParallelWorld.hh
+/// \brief Definition of the ImportanceParallelWorld class
+
+#ifndef ImportanceParallelWorld_h
+#define ImportanceParallelWorld_h 1
+
+#include <vector>
+
+#include "G4VUserParallelWorld.hh"
+#include "globals.hh"
+
+class DetectorConstruction;
+class G4VPhysicalVolume;
+
+// Importance cells for the photon splitting and Russian roulette of
+// G4ImportanceBiasing. The tungsten plate is cut into layers along z, the
+// importance is multiplied by the configured ratio from one layer to the
+// next towards the detector. Everything in front of the plate has
+// importance 1, everything behind it the importance of the last layer, so
+// the vacuum gap itself does not split photons. Nothing is built when
+// the number of layers is 0.
+class ImportanceParallelWorld : public G4VUserParallelWorld {
+public:
+  ImportanceParallelWorld(const G4String &worldName,
+                          DetectorConstruction *detector);
+  virtual ~ImportanceParallelWorld();
+
+  // the physics list refers to the parallel world by this name
+  static G4String GetDefaultName() { return "importanceWorld"; }
+
+  virtual void Construct();
+  // fills the importance store of the thread
+  virtual void ConstructSD();
+
+private:
+  DetectorConstruction *fDetector;
+  std::vector<G4VPhysicalVolume *> fCells;
+  std::vector<G4double> fImportances;
+};
+
+#endif
@@ -0,0 +1,49 @@
+//
+/// \file LineSource.hh
+/// \brief Definition of the LineSource class
+
+#ifndef LineSource_h
+#define LineSource_h 1
+
+#include <string>
+#include <vector>
+
+#include "AliasTable.hh"
+
+// Radionuclide source with tabulated emission lines. The data file has one
+// line per emission: energy (keV) and intensity (photons per 100 decays),
+// lines starting with # are comments.
+//
+// Each line is emitted independently with its intensity, decays without
+// any photon are skipped. The number of photons of a decay is sampled from
+// this distribution and each photon from the intensities, so the mean
+// number of photons of every line is exact, only the correlations between
+// the lines of one decay are lost.
+class LineSource {
+public:
+  LineSource();
+
+  // name of a dataset in data/ (e.g. Ba133) or path of a .dat file
+  bool Load(const std::string &name);
+
+  int SampleMultiplicity(double u) const {
+    return fMultiplicity.Sample(u) + 1;
+  }
+  // energy in keV
+  double SampleEnergy(double u) const { return fEnergies[fLines.Sample(u)]; }
+
+  const std::string &GetFilename() const { return fFilename; }
+  const std::vector<double> &GetEnergies() const { return fEnergies; }
+  const std::vector<double> &GetIntensities() const { return fIntensities; }
+  double GetMeanMultiplicity() const { return fMeanMultiplicity; }
+
+private:
+  std::string fFilename;
+  std::vector<double> fEnergies;
+  std::vector<double> fIntensities;
+  AliasTable fLines;
+  AliasTable fMultiplicity; // index 0 is one photon
+  double fMeanMultiplicity;
+};
+
+#endif
@@ -0,0 +1,45 @@
+//
+/// \file OutputLayout.hh
+/// \brief Layout of the g4main outputs, shared by g4main and the tools
+
+#ifndef OutputLayout_h
+#define OutputLayout_h 1
+
+#include "TString.h"
+
+class TH1F;
+
+// pixels of the events tree
+const int NUM_PIXELS = 12;
+// hits stored per event by --save-hits
+const int MAX_HITS = 4096;
+// the inp tree stores y and z in mm relative to these
+const double PY_ORIGIN = 103.1;
+const double PZ_ORIGIN = 127.5;
+
+// energy spectra of AnalysisManager which are not in science channels
+const int SPECTRUM_NUM_BINS = 1500;
+const double SPECTRUM_MAX_ENERGY = 150; // keV
+// slot of the detector sum in the AnalysisManager spectra
+const int SUMMED_SPECTRUM_SLOT = 32;
+
+// per pixel spectra of g4redigi and g4analysis, with the names and the
+// binning of the AnalysisManager ones
+enum PixelSpectrum {
+  kEdepSpectrum,    // hEdep, deposited energy
+  kRealSpectrum,    // hReal, recorded energy
+  kEdepSciSpectrum, // hEdepSci, deposited energy in science channels
+  kRealSciSpectrum, // hRealSci, recorded energy in science channels
+  NUM_PIXEL_SPECTRA
+};
+
+bool IsScienceSpectrum(int spectrum);
+// hEdepPixelN, ... for the pixel N, and the AnalysisManager names
+// hEdep32, ... for the pixel NUM_PIXELS, the pixel sum; hEdep0 of g4main
+// is the detector 0, not the pixel 0
+TString GetPixelSpectrumName(int spectrum, int pixel);
+TString GetPixelSpectrumTitle(int spectrum, int pixel);
+// an empty spectrum with the name, the title and the binning above
+TH1F *BookPixelSpectrum(int spectrum, int pixel);
+
+#endif
@@ -0,0 +1,19 @@
+//
+/// \file OutputMerger.hh
+/// \brief Merging of g4main output files
+
+#ifndef OutputMerger_h
+#define OutputMerger_h 1
+
+#include <vector>
+
+#include "TString.h"
+
+// Merges the trees, the hist/ directory and the metadata of several g4main
+// output files into one file. Trees are merged basket by basket, so the
+// memory use does not grow with the number of entries. Only ROOT is used
+// here, the function is shared by g4main and the command line tools.
+bool MergeOutputFiles(const std::vector<TString> &inputs,
+                      const TString &output);
+
+#endif
@@ -0,0 +1,24 @@
+//
+/// \file PhaseSpaceSD.hh
+/// \brief Definition of the PhaseSpaceSD class
+
+#ifndef PhaseSpaceSD_h
+#define PhaseSpaceSD_h 1
+
+#include "G4VSensitiveDetector.hh"
+#include "globals.hh"
+
+class G4Step;
+class G4TouchableHistory;
+
+// thin scoring plane, records every particle entering it into the phsp
+// tree, the particles are not modified
+class PhaseSpaceSD : public G4VSensitiveDetector {
+public:
+  PhaseSpaceSD(const G4String &name);
+  virtual ~PhaseSpaceSD();
+
+  virtual G4bool ProcessHits(G4Step *aStep, G4TouchableHistory *history);
+};
+
+#endif
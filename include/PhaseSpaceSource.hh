@@ -0,0 +1,61 @@
+//
+/// \file PhaseSpaceSource.hh
+/// \brief Definition of the PhaseSpaceSource class
+
+#ifndef PhaseSpaceSource_h
+#define PhaseSpaceSource_h 1
+
+#include <vector>
+
+#include "G4ThreeVector.hh"
+#include "Rtypes.h"
+#include "globals.hh"
+
+class G4Event;
+class G4ParticleGun;
+class TChain;
+
+// Replays the phsp trees written by the phase space plane. The records of
+// one first stage event are replayed together as one event, so that the
+// pixel sums see the whole history. Every history is used numUses times
+// by consecutive global events, with its weights divided by numUses.
+// Random rotations around the z axis, the same for the whole history, can
+// be enabled when the setup is symmetric. One instance per thread, the
+// history index is built once by the master and shared by the threads.
+class PhaseSpaceSource {
+public:
+  // comma separated files or patterns, historyStart from BuildHistoryIndex
+  PhaseSpaceSource(const G4String &files,
+                   const std::vector<Long64_t> *historyStart, G4int numUses,
+                   G4bool rotate);
+  ~PhaseSpaceSource();
+
+  // events of the first stage runs, from hist/hNumEvents of the files;
+  // -1 if a file does not have it
+  static Long64_t CountFirstStageEvents(const G4String &files);
+  // first entry of every history, followed by the number of entries;
+  // false if the files have no records
+  static G4bool BuildHistoryIndex(const G4String &files,
+                                  std::vector<Long64_t> &historyStart);
+
+  // false when the event is beyond the last history
+  G4bool GeneratePrimary(G4ParticleGun *gun, G4Event *event,
+                         Long64_t globalEventID);
+
+private:
+  G4bool Open();
+
+  G4String fFiles;
+  G4int fNumUses;
+  G4bool fRotate;
+  TChain *fChain;
+  const std::vector<Long64_t> *fHistoryStart;
+
+  Int_t fPDG;
+  Float_t fEnergy;
+  Float_t fPos[3];
+  Float_t fDir[3];
+  Float_t fWeight;
+};
+
+#endif
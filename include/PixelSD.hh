@@ -0,0 +1,26 @@
+//
+/// \file PixelSD.hh
+/// \brief Definition of the PixelSD class
+
+#ifndef PixelSD_h
+#define PixelSD_h 1
+
+#include "G4VSensitiveDetector.hh"
+#include "globals.hh"
+
+class G4Step;
+class G4TouchableHistory;
+
+// CdTe pixels, the copy number of the pixel is the channel
+class PixelSD : public G4VSensitiveDetector {
+public:
+  PixelSD(const G4String &name, G4double thickness);
+  virtual ~PixelSD();
+
+  virtual G4bool ProcessHits(G4Step *aStep, G4TouchableHistory *history);
+
+private:
+  G4double fThickness; // CdTe thickness, the cathode is at +z
+};
+
+#endif
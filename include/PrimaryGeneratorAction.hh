@@ -5,6 +5,8 @@
 #ifndef PrimaryGeneratorAction_h
 #define PrimaryGeneratorAction_h 1
 
+#include <vector>
+
 #include "G4ThreeVector.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "TString.h"
@@ -20,6 +22,12 @@ class TTree;
 class TH1F;
 class TFile;
 class t2sim;
+class RayTracer;
+class LineSource;
+class SpectrumSampler;
+class PhaseSpaceSource;
+class ApertureSampler;
+class G4PrimaryVertex;
 // class PrimaryGeneratorMessenger;
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
 public:
@@ -28,11 +36,24 @@ public:
 
   virtual void GeneratePrimaries(G4Event *event);
 
-  void SetParticleSource(G4String val) { particleSource = val; }
-  void InitParticleSpectrumFromROOT(G4String val);
+  // "Ba133" or any other dataset of data/, or a .dat file of lines
+  void SetParticleSource(G4String val);
+  // energies of the GPS primaries are sampled from this spectrum, which
+  // is shared by the threads
+  void SetSpectrumSampler(const SpectrumSampler *val) { fSpectrum = val; }
+  // replay the particles of t2sim trees, comma separated files or patterns
+  void SetInputFile(G4String val);
+  // replay phsp trees, each first stage event numUses times; the history
+  // index is shared by the threads, see PhaseSpaceSource
+  void SetPhaseSpaceInput(G4String files,
+                          const std::vector<Long64_t> *historyStart,
+                          G4int numUses, G4bool rotate);
+  // this fraction of the GPS primaries is moved over the slit apertures,
+  // weighted, see ApertureSampler; 0 disables the biasing
+  void SetApertureBias(G4double val) { apertureBias = val; }
+  // each event traces this many GPS rays instead of tracking a primary
+  void SetRaytrace(G4int val) { numRays = val; }
   G4bool InitFile();
-  void GetGPS(G4ThreeVector &position, G4ThreeVector &direction,
-              G4double &energy);
 
 private:
   G4GeneralParticleSource *fParticleSource;
@@ -40,16 +61,26 @@ private:
   //	PrimaryGeneratorMessenger* fParticleGunMessenger;
 
   G4int sourceType; // 0: use particle source ; else use particle gun
-  G4String particleSource, particleSourceFile;
-  G4int iEntry;   // entry read
-  G4int nEntries; // total entries
-  TFile *fHistoEnergy;
-  TH1F *histoEnergy;
+  G4String particleSource;
+  G4int iEntry;      // entry read
+  Long64_t nEntries; // total entries
+  const SpectrumSampler *fSpectrum;
 
   TTree *fTree;
   TFile *fFile;
   t2sim *ts;
   G4ParticleTable *particleTable;
+
+  void TraceRays();
+  G4double BiasVertex(G4PrimaryVertex *vertex);
+  void ReplayParticle(G4Event *event);
+  G4String inputFilename;
+  G4int numRays;
+  RayTracer *fRayTracer;
+  LineSource *fLineSource;
+  PhaseSpaceSource *fPhaseSpace;
+  G4double apertureBias;
+  ApertureSampler *fAperture;
 };
 
 #endif
@@ -0,0 +1,34 @@
+//
+/// \file RayTracer.hh
+/// \brief Definition of the RayTracer class
+
+#ifndef RayTracer_h
+#define RayTracer_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class AttenuationTable;
+class G4LogicalVolume;
+class G4Navigator;
+
+// Casts straight rays through the geometry and returns the probability
+// that a photon reaches the detector plane without interacting,
+// exp(-sum mu L) over the volumes on the way. One instance per thread.
+class RayTracer {
+public:
+  RayTracer();
+  ~RayTracer();
+
+  // returns 0 if the ray leaves the world without hitting the detector,
+  // otherwise the transmission and the entry point on the detector
+  G4double Trace(const G4ThreeVector &position, const G4ThreeVector &direction,
+                 G4double energy, G4ThreeVector &hitPosition);
+
+private:
+  G4Navigator *fNavigator;
+  AttenuationTable *fTable;
+  G4LogicalVolume *fDetectorLog;
+};
+
+#endif
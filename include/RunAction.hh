@@ -9,6 +9,7 @@
 #include "globals.hh"
 
 class G4Run;
+class G4Timer;
 
 class RunAction : public G4UserRunAction {
 public:
@@ -17,6 +18,9 @@ public:
 
   virtual void BeginOfRunAction(const G4Run *);
   virtual void EndOfRunAction(const G4Run *);
+
+private:
+  G4Timer *fTimer;
 };
 
 #endif
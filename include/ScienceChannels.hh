@@ -0,0 +1,20 @@
+//
+/// \file ScienceChannels.hh
+/// \brief STIX science energy channels, shared by g4main and the tools
+
+#ifndef ScienceChannels_h
+#define ScienceChannels_h 1
+
+class TH1;
+
+const int NUM_SCIENCE_CHANNELS = 32;
+// channel edges in keV, the last channel collects everything above 150 keV
+extern const double SCIENCE_ENERGY_EDGES[NUM_SCIENCE_CHANNELS + 1];
+
+// channel of a recorded energy in keV, energies below 4 keV go to 0
+int GetScienceChannel(double energy);
+// divides the contents and errors by the channel widths, false if the
+// histogram is not binned in science channels
+bool NormalizeScienceSpectrum(TH1 *h);
+
+#endif
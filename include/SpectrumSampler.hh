@@ -0,0 +1,37 @@
+//
+/// \file SpectrumSampler.hh
+/// \brief Definition of the SpectrumSampler class
+
+#ifndef SpectrumSampler_h
+#define SpectrumSampler_h 1
+
+#include <vector>
+
+#include "AliasTable.hh"
+#include "TString.h"
+
+// Energy spectrum read from a TH1 (x axis in keV), sampled in constant time
+// whatever the number of bins: the bin from an alias table of the bin
+// contents, the energy uniformly in the bin or, with interpolation, from a
+// linear density between the estimated densities at the bin edges. It is
+// not modified after Load, so one instance is shared by all threads.
+class SpectrumSampler {
+public:
+  SpectrumSampler();
+
+  // "spec.root" uses the first TH1 of the file, "spec.root:hspec" the
+  // histogram hspec; false if it can not be read or has no positive bin
+  bool Load(const TString &name);
+  void SetInterpolation(bool val) { fInterpolate = val; }
+
+  // energy in keV from two uniform numbers in [0, 1)
+  double Sample(double u1, double u2) const;
+
+private:
+  std::vector<double> fEdges;
+  std::vector<double> fEdgeDensities; // relative densities at the edges
+  AliasTable fBins;
+  bool fInterpolate;
+};
+
+#endif
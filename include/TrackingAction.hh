@@ -0,0 +1,21 @@
+//
+/// \file TrackingAction.hh
+/// \brief Definition of the TrackingAction class
+
+#ifndef TrackingAction_h
+#define TrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+#include "globals.hh"
+
+// tells the AnalysisManager which split copy of the history each track
+// belongs to, see AnalysisManager::BeginTrack
+class TrackingAction : public G4UserTrackingAction {
+public:
+  TrackingAction();
+  virtual ~TrackingAction();
+
+  virtual void PreUserTrackingAction(const G4Track *track);
+};
+
+#endif
@@ -32,10 +32,15 @@
 #ifndef XrayFluoPhysicsList_h
 #define XrayFluoPhysicsList_h 1
 
+#include <map>
+
 #include "G4VModularPhysicsList.hh"
 #include "globals.hh"
 
 class G4VPhysicsConstructor;
+class G4FastSimulationPhysics;
+class G4GeometrySampler;
+class G4ImportanceBiasing;
 class XrayFluoPhysicsListMessenger;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -52,6 +57,7 @@ public:
   void ConstructProcess();
   void AddDecay();
   void AddStepMax();
+  void AddRangeRejection();
 
   void SetCuts();
   void SetCutForGamma(G4double);
@@ -62,16 +68,44 @@ public:
   void SetPIXE(G4bool);
   void SetPhysListName(G4String name) { AddPhysicsList(name); }
 
+  // per region settings, the regions are "Collimator", "Detector" and
+  // "World" (the default region)
+  void SetRegionCut(const G4String &region, G4double cut);
+  void SetRangeRejection(const G4String &region, G4double range);
+  void SetWoodcockRegion(const G4String &region);
+
+  // physics tables are stored in this directory, keyed by a fingerprint of
+  // the materials, cuts and EM settings, and retrieved on the next start
+  void SetPhysicsTableCacheDir(const G4String &dir) { tableCacheDir = dir; }
+  void StorePhysicsTableCache();
+
 private:
   XrayFluoPhysicsListMessenger *pMessenger;
 
   G4String emName;
   G4VPhysicsConstructor *emPhysicsList;
+  G4FastSimulationPhysics *fastSimPhysics;
+  void AddFastSimulation();
+  G4GeometrySampler *importanceSampler;
+  G4ImportanceBiasing *importanceBiasing;
+  void AddImportanceBiasing();
 
   G4double cutForGamma;
   G4double cutForElectron;
   G4double cutForPositron;
   G4double cutForProton;
+
+  void ApplyRegionCut(const G4String &region, G4double cut, G4bool verbose);
+  std::map<G4String, G4double> regionCuts;
+  std::map<G4String, G4double> rangeRejection;
+
+  G4String ComputePhysicsFingerprint();
+  // cut or EM changes after the initialization, the tables keyed at
+  // initialization are neither retrieved nor stored
+  void InvalidatePhysicsTableCache();
+  G4String tableCacheDir;
+  G4String physicsTableDir;
+  G4bool tablesCached;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
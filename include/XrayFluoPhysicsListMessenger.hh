@@ -40,6 +40,7 @@ class G4UIdirectory;
 class G4UIcmdWithAString;
 class G4UIcmdWithABool;
 class G4UIcmdWithADoubleAndUnit;
+class G4UIcommand;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -61,6 +62,12 @@ private:
   G4UIcmdWithADoubleAndUnit *allCutCmd;
   G4UIcmdWithABool *fluoCmd;
   G4UIcmdWithABool *pixeCmd;
+
+  G4UIdirectory *regionDir;
+  G4UIcommand *regionCutCmd;
+  G4UIcommand *rangeRejectionCmd;
+  G4UIcmdWithAString *woodcockCmd;
+  G4UIcmdWithAString *tableCacheCmd;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,46 @@
+//
+/// \file XrayFluoRangeRejection.hh
+/// \brief Definition of the XrayFluoRangeRejection class
+
+#ifndef XrayFluoRangeRejection_h
+#define XrayFluoRangeRejection_h 1
+
+#include <map>
+
+#include "G4ParticleDefinition.hh"
+#include "G4Step.hh"
+#include "G4VDiscreteProcess.hh"
+#include "globals.hh"
+
+class G4Region;
+
+// Kills electrons which can not leave their volume: the residual range is
+// below both the rejection threshold of the region and the safety. The
+// kinetic energy is deposited locally, so bremsstrahlung and fluorescence
+// of the killed electron are lost, which bounds the useful threshold.
+class XrayFluoRangeRejection : public G4VDiscreteProcess {
+public:
+  // thresholds by region name, owned by the physics list
+  XrayFluoRangeRejection(const std::map<G4String, G4double> *thresholds,
+                         const G4String &processName = "rangeRejection");
+  ~XrayFluoRangeRejection();
+
+  G4bool IsApplicable(const G4ParticleDefinition &);
+  void BuildPhysicsTable(const G4ParticleDefinition &);
+
+  G4double PostStepGetPhysicalInteractionLength(const G4Track &track,
+                                                G4double previousStepSize,
+                                                G4ForceCondition *condition);
+
+  G4VParticleChange *PostStepDoIt(const G4Track &, const G4Step &);
+
+  G4double GetMeanFreePath(const G4Track &, G4double, G4ForceCondition *) {
+    return DBL_MAX;
+  }
+
+private:
+  const std::map<G4String, G4double> *fThresholdsByName;
+  std::map<const G4Region *, G4double> fThresholds;
+};
+
+#endif
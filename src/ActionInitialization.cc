@@ -0,0 +1,49 @@
+/***************************************************************
+ * Action initialization, shared by sequential and MT runs
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "ActionInitialization.hh"
+
+#include "EventAction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "RunAction.hh"
+#include "TrackingAction.hh"
+
+ActionInitialization::ActionInitialization()
+    : G4VUserActionInitialization(), particleSource(""), inputFile(""),
+      phspFiles(""), phspHistories(NULL), phspUses(1), phspRotate(false), spectrum(NULL),
+      numRays(0), apertureBias(0) {}
+
+ActionInitialization::~ActionInitialization() { delete phspHistories; }
+
+void ActionInitialization::BuildForMaster() const {
+  // the master only merges the outputs of the workers
+  SetUserAction(new RunAction());
+}
+
+void ActionInitialization::Build() const {
+  G4cout << "Initializing primary generation" << G4endl;
+  PrimaryGeneratorAction *primarygen = new PrimaryGeneratorAction();
+  if (particleSource != "") {
+    primarygen->SetParticleSource(particleSource);
+  }
+  if (phspFiles != "") {
+    primarygen->SetPhaseSpaceInput(phspFiles, phspHistories, phspUses,
+                                   phspRotate);
+  }
+  primarygen->SetSpectrumSampler(spectrum);
+  if (inputFile != "") {
+    primarygen->SetInputFile(inputFile);
+  }
+  primarygen->SetRaytrace(numRays);
+  primarygen->SetApertureBias(apertureBias);
+  G4cout << "Set particle type:" << particleSource << G4endl;
+  SetUserAction(primarygen);
+
+  SetUserAction(new RunAction());
+  SetUserAction(new EventAction());
+  SetUserAction(new TrackingAction());
+  // no stepping action, hits are recorded by the sensitive detectors
+}
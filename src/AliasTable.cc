@@ -0,0 +1,51 @@
+/***************************************************************
+ * Alias tables for sampling discrete distributions
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "AliasTable.hh"
+
+#include <cstddef>
+
+void AliasTable::Build(const std::vector<double> &weights) {
+  // Vose's construction, each bin keeps its own index with probability
+  // fProb[i] and otherwise returns fAlias[i]
+  int n = weights.size();
+  fProb.assign(n, 1.);
+  fAlias.resize(n);
+  double sum = 0;
+  for (int i = 0; i < n; i++) {
+    fAlias[i] = i;
+    sum += weights[i];
+  }
+  if (n == 0 || sum <= 0)
+    return;
+
+  std::vector<double> scaled(n);
+  std::vector<int> small, large;
+  for (int i = 0; i < n; i++) {
+    scaled[i] = weights[i] * n / sum;
+    if (scaled[i] < 1)
+      small.push_back(i);
+    else
+      large.push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    int s = small.back();
+    small.pop_back();
+    int l = large.back();
+    fProb[s] = scaled[s];
+    fAlias[s] = l;
+    scaled[l] -= 1 - scaled[s];
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // the rest is 1 up to rounding errors
+  for (size_t i = 0; i < small.size(); i++)
+    fProb[small[i]] = 1.;
+  for (size_t i = 0; i < large.size(); i++)
+    fProb[large[i]] = 1.;
+}
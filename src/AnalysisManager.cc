@@ -5,126 +5,135 @@
  ***************************************************************/
 #include "AnalysisManager.hh"
 
+#include "G4AutoLock.hh"
 #include "G4Event.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4Step.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
 #include "G4ThreeVector.hh"
+#include "G4ParticleDefinition.hh"
 #include "G4Track.hh"
 #include "G4TrackStatus.hh"
+#include "G4VProcess.hh"
 #include "G4TrackVector.hh"
 #include "G4UnitsTable.hh"
-#include "G4VUserPrimaryGeneratorAction.hh"
-#include "PrimaryGeneratorAction.hh"
+#include "DetectorConstruction.hh"
+#include "DetectorResponse.hh"
+#include "OutputMerger.hh"
+#include "Randomize.hh"
+#include "ScienceChannels.hh"
 #include "TCanvas.h"
 #include "TDirectory.h"
 #include "TFile.h"
+#include "TH1D.h"
 #include "TH1F.h"
 #include "TH2F.h"
 #include "TNamed.h"
-#include "TRandom.h"
+#include "TRandom3.h"
 #include "TString.h"
+#include "TSystem.h"
 #include "TTree.h"
 
+namespace {
+G4Mutex workerFilesMutex = G4MUTEX_INITIALIZER;
+
+// the workers share the detector construction of the master
+const DetectorConstruction *GetDetector() {
+	return static_cast<const DetectorConstruction *>(
+			G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+}
+}
+
 bool DEBUG = false;
 const int MAX_NUM_TREE_TO_FILL = 1000000;
 // number of photons to fill to the tracking tree
 
-const G4double highVoltage =
-300;                      // CdTe HV is 300 during the nominal operations
-const G4double ENOISE = 0.43; // keV
-							  // 0.52 is from the best fit
-							  // from gussian fit, it should be 1.2/2.35=0.5
-
-const G4double FANO_FACTOR = 0.15; // from best fit
-
-G4double NEAR_SURFACE_L =
-5.28e-3; // see Oliver's paper, in units of mm, take the mean value
-G4double NEAR_SURFACE_R0 =
-0.116; // see Oliver's paper, in units of mm, mean value are take
-	   // best FIT L-=5.28e-3,R0=0.1 , set enoise=0.52, fanao=0.15
-
-	   // CdTe fano factor is 0.15 according to
-	   // https://www.researchgate.net/figure/Fano-factor-for-different-semiconductor-at-room-temperature_tbl5_343053397
-	   // On Jun 27, the enoise and fano factor were found to be .24 and 0.74 through
-	   // fitting of Ba133 exp sim spectrum, see:
-	   // ~/FHNW/STIX/SolarFlareAnalysis/fitG4CalibrationSpectrum
-
-const G4double threshold = 4;
-/* At 30 keV, the energy resolution is 2%  * 30 keV= 0.6 keV
- * using fano factor, one could know the intrinsic resolution of CdTe is
- * rho=(pairs * 0.15)/pairs =0.0047 absolute resolution is rho*30 = 0.14 keV ADC
- * resolution is 0.5 ADC channel,this is equivalent  to 0.5 /2.3 =0.2 keV for
- * calibration spectrum electronics noise = sqrt(0.6*0.6 -0.14*0.14 - 0.2*0.2)
- */
-
 const G4double CdTe_SURFACE_X =
 12.7741; // surface x-coordinates of CdTe detectors, using geant4 tracks to
 		 // find the position, 2023-06-26, not it can be 13.774
-const G4double PY_ORIGIN = 103.1;
-const G4double PZ_ORIGIN = 127.5;
-
-const G4double PAIR_CREATION_ENERGY = 4.46e-3; // in units of keV
-
-double energyRanges[] = {0,  4,  5,  6,  7,  8,  9,  10,  11,  12,  13,
-	14, 15, 16, 18, 20, 22, 25, 28,  32,  36,  40,
-	45, 50, 56, 63, 70, 76, 84, 100, 120, 150, 250};
 
 void normalizedEnergySpectrum(TH1F *h) {
-	// energy bin widths are different, we need to  divide the counts by energy
-	// bin width
-	int nbins = h->GetXaxis()->GetNbins();
-	if (nbins != 32) {
+	if (!NormalizeScienceSpectrum(h))
 		G4cout << "Can not normalize histogram" << G4endl;
-		return;
-	}
-	for (int i = 0; i < 32; i++) {
-		double binW = energyRanges[i + 1] - energyRanges[i];
-		if (binW > 0) {
-			h->SetBinContent(i + 1, h->GetBinContent(i + 1) / binW);
-		}
-	}
 }
 
-int getScienceBin(Double_t energy) {
-	if (energy < 4) {
-		return 0;
-	} else if (energy >= 150) {
-		return 31;
-	} else {
-		for (int i = 0; i < 31; i++) {
-			if (energy >= energyRanges[i] && energy < energyRanges[i + 1])
-				return i;
-		}
-	}
-	return 31;
-}
+const double histMaxEnergy = SPECTRUM_MAX_ENERGY;
+const int histNbins = SPECTRUM_NUM_BINS;
 
-const double histMaxEnergy = 150;
-int histNbins = (int)(histMaxEnergy / 0.1);
+G4ThreadLocal AnalysisManager *AnalysisManager::fManager = 0;
+AnalysisManager *AnalysisManager::fMasterManager = 0;
+std::vector<TString> AnalysisManager::fWorkerFiles;
 
-AnalysisManager *AnalysisManager::fManager = 0;
 AnalysisManager *AnalysisManager::GetInstance() {
 	if (!fManager) {
 		fManager = new AnalysisManager();
+		if (G4Threading::IsMasterThread()) {
+			fMasterManager = fManager;
+		} else if (fMasterManager) {
+			// workers are created after the command line has been parsed
+			fManager->CopyConfiguration(fMasterManager);
+		}
 	}
 	return fManager;
 }
 AnalysisManager::AnalysisManager() {
 
 	//isDummyDetector=false;
+	rootFile = NULL;
+	c1 = NULL;
+	eventID = 0;
+	randomSeed = 0;
+	eventIDOffset = 0;
+	fRandom = new TRandom3();
+	fResponse = new DetectorResponse();
 	numKilled = 0;
-	isNewEvent = true;
 	numEventIn = 0;
 	numEventOut = 0;
 	killTracksEnteringGrids = false;
 	killTracksEnteringDetectors = false;
+	saveEvents = false;
+	importanceSplitting = false;
+	currentCopy = 0;
+	saveHits = false;
+	debugNearSurfaceR0 = 0;
+	debugNearSurfaceL = 0;
+	numHitsDropped = 0;
+	hitsTruncated = false;
+	responseBins = 0;
+	responseMin = 0;
+	responseMax = 0;
+	hResponseE0 = NULL;
+	hNumEvents = NULL;
+	phspInputFiles = "";
+	phspInputEvents = -1;
+	phspInputUses = 1;
 	numInpTreeFilled = 0;
-	numSourceTreeFilled= 0;
 
 	numPhysTreeFilled = 0;
 }
+void AnalysisManager::CopyConfiguration(const AnalysisManager *master) {
+	outputFilename = master->outputFilename;
+	macroFilename = master->macroFilename;
+	commandLine = master->commandLine;
+	randomSeed = master->randomSeed;
+	eventIDOffset = master->eventIDOffset;
+	killTracksEnteringGrids = master->killTracksEnteringGrids;
+	killTracksEnteringDetectors = master->killTracksEnteringDetectors;
+	saveEvents = master->saveEvents;
+	saveHits = master->saveHits;
+	responseBins = master->responseBins;
+	responseMin = master->responseMin;
+	responseMax = master->responseMax;
+}
+G4bool AnalysisManager::IsMergingMaster() const {
+	// in MT mode the master doesn't process events, it only merges
+	return G4Threading::IsMultithreadedApplication() &&
+		G4Threading::IsMasterThread();
+}
 void AnalysisManager::CopyMacrosToROOT(TFile *f, TString &macfilename) {
 	G4cout << "Copying macros from file " << macfilename << " to root file"
 		<< G4endl;
@@ -144,10 +153,23 @@ void AnalysisManager::CopyMacrosToROOT(TFile *f, TString &macfilename) {
 		G4cout << line << G4endl;
 	}
 	macros += "---------------  Realistic simulation parameters---------------";
-	macros += Form("\nNear surface R0: %f\n ", NEAR_SURFACE_R0);
-	macros += Form("\nNear surface L: %f\n ", NEAR_SURFACE_L);
-	macros += Form("\nFanno factor : %f\n ", FANO_FACTOR);
-	macros += Form("\nENOIS (eV): %f\n ", ENOISE);
+	macros += Form("\nDetector response: %s\n ", fResponse->Describe().c_str());
+	macros += Form("\nRandom seed: %ld\n ", randomSeed);
+	macros += Form("\nEvent ID offset: %ld\n ", eventIDOffset);
+	macros += Form("\nPlate half depth: %g mm\n ",
+			GetDetector()->GetPlateHalfDepth() / mm);
+	if (phspInputFiles != "") {
+		// the weights of the replays sum to the histories of the first
+		// stage, spectra per incident particle are divided by its events
+		macros += Form("\nPhase space input: %s, first stage events: %lld, "
+				"uses per event: %d\n ",
+				phspInputFiles.c_str(), phspInputEvents, phspInputUses);
+	}
+	if (GetDetector()->GetImportanceLayers() > 0) {
+		macros += Form("\nImportance splitting: %d layers, the pixel outputs "
+				"have one entry per split copy\n ",
+				GetDetector()->GetImportanceLayers());
+	}
 	TNamed cmd;
 	cmd.SetTitle(macros);
 	f->cd();
@@ -156,7 +178,23 @@ void AnalysisManager::CopyMacrosToROOT(TFile *f, TString &macfilename) {
 }
 
 void AnalysisManager::InitRun(const G4Run *run) {
-	rootFile = new TFile(outputFilename.Data(), "recreate");
+	// the deposits of the split copies of a photon are kept apart and each
+	// copy is digitized and counted on its own, see BeginTrack
+	importanceSplitting = GetDetector()->GetImportanceLayers() > 0;
+	if (IsMergingMaster()) {
+		G4AutoLock lock(&workerFilesMutex);
+		fWorkerFiles.clear();
+		return;
+	}
+	threadOutputFilename = outputFilename;
+	if (G4Threading::IsWorkerThread()) {
+		// each worker writes to a temporary file, merged by the master
+		if (threadOutputFilename.EndsWith(".root")) {
+			threadOutputFilename.Remove(threadOutputFilename.Length() - 5);
+		}
+		threadOutputFilename += Form("_t%d.root", G4Threading::G4GetThreadId());
+	}
+	rootFile = new TFile(threadOutputFilename.Data(), "recreate");
 
 	evtTree = new TTree("events", "events");
 	evtTree->Branch("edep", edepSum, Form("edep[%d]/D", NUM_CHANNELS));
@@ -168,7 +206,7 @@ void AnalysisManager::InitRun(const G4Run *run) {
 			Form("charge[%d]/D", NUM_CHANNELS));
 	evtTree->Branch("charge2", collectedEdepSumRealistic,
 			Form("charge2[%d]/D", NUM_CHANNELS));
-	evtTree->Branch("eventID", &eventID, "eventID/I");
+	evtTree->Branch("eventID", &eventID, "eventID/L");
 	evtTree->Branch("E0", &gunEnergy, "E0/D");
 	evtTree->Branch("gunPos", gunPosition, Form("gunPos[%d]/D", 3));
 	evtTree->Branch("gunVec", gunDirection, Form("gunVec[%d]/D", 3));
@@ -183,10 +221,13 @@ void AnalysisManager::InitRun(const G4Run *run) {
 	evtTree->Branch("energy", energy, Form("energy[%d]/D", MAX_TRACKS));
 	evtTree->Branch("time", time, Form("time[%d]/D", MAX_TRACKS));
 	evtTree->Branch("totalNumSteps", &totalNumSteps, "totalNumSteps/I");
+	evtTree->Branch("weight", &eventWeight, "weight/D");
+	evtTree->Branch("channelWeight", channelWeight,
+			Form("channelWeight[%d]/D", NUM_CHANNELS));
 
 	if (DEBUG) {
-		evtTree->Branch("R0", &NEAR_SURFACE_R0, "R0/D");
-		evtTree->Branch("L", &NEAR_SURFACE_L, "L/D");
+		evtTree->Branch("R0", &debugNearSurfaceR0, "R0/D");
+		evtTree->Branch("L", &debugNearSurfaceL, "L/D");
 	}
 	physTree = new TTree("phys", "phys");
 	physTree->Branch("type", &processType, "type/I");
@@ -194,11 +235,12 @@ void AnalysisManager::InitRun(const G4Run *run) {
 	physTree->Branch("E0", &gunEnergy, "gunEnergy/D");
 	physTree->Branch("pdg", &inpPDG, "pdg/I");
 	physTree->Branch("parent", &parentID, "parentID/I");
+	physTree->Branch("weight", &inpWeight, "weight/D");
 
 	inpTree = new TTree("inp", "inp");
 	inpTree->Branch("pos", inpPos, "pos[3]/D");
 	inpTree->Branch("E0", &gunEnergy, "E0/D");
-	inpTree->Branch("eventID", &eventID, "eventID/I");
+	inpTree->Branch("eventID", &eventID, "eventID/L");
 	inpTree->Branch("itrack", &itrack, "itrack/I");
 	inpTree->Branch("boundary", &boundary, "boundary/I");
 	inpTree->Branch("pixelID", &pixelID, "pixelID/I");
@@ -208,17 +250,45 @@ void AnalysisManager::InitRun(const G4Run *run) {
 	inpTree->Branch("energy", &inpEnergy, "energy/D");
 	inpTree->Branch("pdg", &inpPDG, "pdg/I");
 	inpTree->Branch("parent", &parentID, "parent/I");
+	inpTree->Branch("weight", &inpWeight, "weight/D");
 
 
 
 
 	primTree = new TTree("source", "source");
 	primTree->Branch("pos", gunPosition, "pos[3]/D");
-	primTree->Branch("eventID", &eventID, "eventID/I");
+	primTree->Branch("eventID", &eventID, "eventID/L");
 	primTree->Branch("vec", gunDirection, "vec[3]/D");
 	primTree->Branch("E0", &gunEnergy, "E0/D");
-
-	c1 = new TCanvas("c1", "c1", 10, 10, 800, 800);
+	primTree->Branch("numPrimaries", &numPrimaries, "numPrimaries/I");
+	primTree->Branch("weight", &eventWeight, "weight/D");
+
+	// single precision, the files are meant to be replayed many times
+	phspTree = new TTree("phsp", "phase space");
+	phspTree->Branch("eventID", &eventID, "eventID/L");
+	phspTree->Branch("pdg", &phspPDG, "pdg/I");
+	phspTree->Branch("energy", &phspEnergy, "energy/F");
+	phspTree->Branch("pos", phspPos, "pos[3]/F");
+	phspTree->Branch("dir", phspDir, "dir[3]/F");
+	phspTree->Branch("weight", &phspWeight, "weight/F");
+
+	// one entry per event with deposits, the detector effects are not
+	// applied
+	hitsTree = new TTree("hits", "raw energy deposits in the pixels");
+	hitsTree->Branch("eventID", &eventID, "eventID/L");
+	hitsTree->Branch("E0", &gunEnergy, "E0/D");
+	hitsTree->Branch("weight", &eventWeight, "weight/D");
+	hitsTree->Branch("nHits", &numHits, "nHits/I");
+	hitsTree->Branch("pixel", rawPixel, "pixel[nHits]/S");
+	hitsTree->Branch("depth", rawDepth, "depth[nHits]/F");
+	hitsTree->Branch("edep", rawEdep, "edep[nHits]/F");
+	hitsTree->Branch("time", rawTime, "time[nHits]/F");
+	hitsTree->Branch("hitWeight", rawWeight, "hitWeight[nHits]/F");
+	hitsTree->Branch("truncated", &hitsTruncated, "truncated/O");
+
+	if (!G4Threading::IsWorkerThread()) {
+		c1 = new TCanvas("c1", "c1", 10, 10, 800, 800);
+	}
 	/*	for (int i = 0; i < NUM_CHANNELS; i++) {
 		hd[i] = new TH1F(Form("hd%d", i),
 		Form("Spectrum of pixel %d energy depositions; Energy "
@@ -227,6 +297,8 @@ void AnalysisManager::InitRun(const G4Run *run) {
 		200, 0, 500);
 		}
 		*/
+	// all fills are weighted, the errors are kept from the sum of squares
+	TH1::SetDefaultSumw2(kTRUE);
 	TString channelName = "";
 	for (int i = 0; i < 34; i++) {
 		if (i == 8) {
@@ -248,12 +320,12 @@ void AnalysisManager::InitRun(const G4Run *run) {
 				Form("Recorded energy spectrum - Rebinned to SCI "
 					"channels (%s); Energy (keV)",
 					channelName.Data()),
-				32, energyRanges);
+				NUM_SCIENCE_CHANNELS, SCIENCE_ENERGY_EDGES);
 		hEdepSci[i] = new TH1F(Form("hEdepSci%d", i),
 				Form("Deposited energy spectrum - Rebinned to SCI "
 					"channels (%s); Energy (keV)",
 					channelName.Data()),
-				32, energyRanges);
+				NUM_SCIENCE_CHANNELS, SCIENCE_ENERGY_EDGES);
 
 		hReal[i] = new TH1F(Form("hReal%d", i),
 				Form("Recorded energy spectrum  (%s); Energy (keV)",
@@ -269,13 +341,13 @@ void AnalysisManager::InitRun(const G4Run *run) {
 					Form("Recorded energy spectrum - Rebinned to SCI channels "
 						"(%s); Energy (keV)",
 						channelName.Data()),
-					32, energyRanges);
+					NUM_SCIENCE_CHANNELS, SCIENCE_ENERGY_EDGES);
 		hEdepSciSingleHit[i] =
 			new TH1F(Form("hEdepSciSingleHit%d", i),
 					Form("Deposited energy spectrum - Rebinned to SCI channels "
 						"(%s); Energy (keV)",
 						channelName.Data()),
-					32, energyRanges);
+					NUM_SCIENCE_CHANNELS, SCIENCE_ENERGY_EDGES);
 		hRealSingleHit[i] =
 			new TH1F(Form("hRealSingleHit%d", i),
 					Form("Recorded energy spectrum  (%s); Energy (keV)",
@@ -301,15 +373,17 @@ void AnalysisManager::InitRun(const G4Run *run) {
 	hcol = new TH1F("h1ChargeColEff",
 			Form("Distribution of Charge collection efficiency (Fanno: "
 				"%f, ENOISE: %f) ; Efficiency; Counts ;",
-				FANO_FACTOR, ENOISE),
+				fResponse->GetFanoFactor(), fResponse->GetNoise()),
 			200, 0, 1);
 	hNS =
 		new TH1F("hNearSurfaceFactor",
 				Form("CF of surface effect (L:%f; R0:%f); Efficiency; Counts ;",
-					NEAR_SURFACE_L, NEAR_SURFACE_R0),
+					fResponse->GetNearSurfaceL(), fResponse->GetNearSurfaceR0()),
 				200, 0, 1);
 
+	hNumEvents = new TH1D("hNumEvents", "Simulated events; ; Events", 1, 0, 1);
 	hEdepSum->SetCanExtend(TH1::kXaxis);
+	BookResponseMatrices();
 
 	// for ROOT version >6.0
 }
@@ -317,6 +391,10 @@ void AnalysisManager::InitRun(const G4Run *run) {
 //////////////////////////////////////////////////////////////////////////
 
 void AnalysisManager::ProcessRun(const G4Run *run) {
+	if (IsMergingMaster()) {
+		MergeWorkerOutputs();
+		return;
+	}
 	CloseROOT();
 	G4cout << "Events entered detectors:" << numEventIn << G4endl;
 	G4cout << "Events escaped from detectors:" << numEventOut << G4endl;
@@ -324,17 +402,38 @@ void AnalysisManager::ProcessRun(const G4Run *run) {
 }
 
 /// EventAction
+void AnalysisManager::SeedEvent(G4int eventid) {
+	// called before the primaries are generated, so that the event is
+	// reproducible from (seed, global event ID) alone
+	G4long globalEventID = GetGlobalEventID(eventid);
+	unsigned long long key =
+		DetectorResponse::GetEventKey(randomSeed, globalEventID);
+	long seeds[3];
+	seeds[0] = (long)(key & 0x7fffffff) | 1;
+	seeds[1] = (long)((key >> 32) & 0x7fffffff) | 1;
+	seeds[2] = 0;
+	G4Random::setTheSeeds(seeds, -1);
+	// an independent stream for the digitization, g4redigi uses the same
+	fRandom->SetSeed(
+		DetectorResponse::GetDigitizationSeed(randomSeed, globalEventID));
+}
+
 void AnalysisManager::InitEvent(const G4Event *event) {
+	eventID = GetGlobalEventID(event->GetEventID());
 
 	if (DEBUG) {
-		NEAR_SURFACE_R0 = 0.1 + 0.8 * G4UniformRand();
-		NEAR_SURFACE_L = (5 + 3.5 * G4UniformRand()) * 1e-3;
+		debugNearSurfaceR0 = 0.1 + 0.8 * G4UniformRand();
+		debugNearSurfaceL = (5 + 3.5 * G4UniformRand()) * 1e-3;
+		fResponse->SetParameter("r0", debugNearSurfaceR0);
+		fResponse->SetParameter("l", debugNearSurfaceL);
 	}
 	for (G4int i = 0; i < NUM_CHANNELS; i++) {
 		edepSum[i] = 0.0;
 		collectedEnergySum[i] = 0;
 		edepWithoutNoise[i] = 0;
 		collectedEdepSumRealistic[i] = 0;
+		edepWeightSum[i] = 0;
+		channelWeight[i] = 0;
 		sci[i] = -1;
 	}
 	for (int i = 0; i < 32; i++)
@@ -352,56 +451,137 @@ void AnalysisManager::InitEvent(const G4Event *event) {
 	}
 	itrack = 0;
 	totalNumSteps = 0;
-	isNewEvent = true;
+	numHits = 0;
+	hitsTruncated = false;
+	trackCopy.clear();
+	copySums.clear();
+	currentCopy = 0;
+	UpdatePrimaryInfo(event);
+}
+
+void AnalysisManager::BeginTrack(const G4Track *track) {
+	if (!importanceSplitting)
+		return;
+	// a split copy starts a new realization of the rest of the history,
+	// the other tracks belong to the copy of their parent. The copy that
+	// keeps the track ID of the split track also keeps the deposits of the
+	// secondaries created before the split, which rarely reach the pixels
+	// as the cells are in the plate
+	G4int trackID = track->GetTrackID();
+	const G4VProcess *creator = track->GetCreatorProcess();
+	if (track->GetParentID() == 0 ||
+			(creator && creator->GetProcessName() == "ImportanceProcess")) {
+		currentCopy = trackID;
+	} else {
+		std::map<G4int, G4int>::const_iterator parent =
+			trackCopy.find(track->GetParentID());
+		currentCopy = parent != trackCopy.end() ? parent->second : trackID;
+	}
+	trackCopy[trackID] = currentCopy;
 }
 void AnalysisManager::ProcessEvent(const G4Event *event) {
-	eventID = event->GetEventID();
+	eventID = GetGlobalEventID(event->GetEventID());
+	hNumEvents->Fill(0.5);
+	// by global event ID, so that the tree does not depend on the number
+	// of threads or shards; the ray tracing events have no primaries
+	if (eventID < 100000 && numPrimaries > 0)
+		primTree->Fill();
+	if (hResponseE0)
+		hResponseE0->Fill(gunEnergy, eventWeight);
+	if (!importanceSplitting) {
+		FillPixelSums();
+		return;
+	}
+	// one pass per split copy, with its own deposits and hits; the
+	// digitization stream of the event runs on from copy to copy
+	std::vector<Short_t> pixels(rawPixel, rawPixel + numHits);
+	std::vector<Float_t> depths(rawDepth, rawDepth + numHits);
+	std::vector<Float_t> edeps(rawEdep, rawEdep + numHits);
+	std::vector<Float_t> times(rawTime, rawTime + numHits);
+	std::vector<Float_t> weights(rawWeight, rawWeight + numHits);
+	std::vector<G4int> copies(rawCopy, rawCopy + numHits);
+	std::map<G4int, CopySums>::const_iterator it;
+	for (it = copySums.begin(); it != copySums.end(); ++it) {
+		for (int i = 0; i < NUM_CHANNELS; i++) {
+			edepSum[i] = it->second.edep[i];
+			collectedEnergySum[i] = it->second.collected[i];
+			edepWeightSum[i] = it->second.edepWeight[i];
+			edepWithoutNoise[i] = 0;
+			collectedEdepSumRealistic[i] = 0;
+			channelWeight[i] = 0;
+			sci[i] = -1;
+		}
+		for (int i = 0; i < 32; i++)
+			nHits[i] = 0;
+		numHits = 0;
+		for (size_t k = 0; k < copies.size(); k++) {
+			if (copies[k] != it->first)
+				continue;
+			rawPixel[numHits] = pixels[k];
+			rawDepth[numHits] = depths[k];
+			rawEdep[numHits] = edeps[k];
+			rawTime[numHits] = times[k];
+			rawWeight[numHits] = weights[k];
+			numHits++;
+		}
+		FillPixelSums();
+	}
+}
+
+void AnalysisManager::FillPixelSums() {
+	// weight of the channels without deposits in the single hit spectra:
+	// the event weight, or the weight of the split copy
+	G4double zeroWeight = eventWeight;
+	if (importanceSplitting) {
+		G4double sum = 0, weightSum = 0;
+		for (int i = 0; i < NUM_CHANNELS; i++) {
+			sum += edepSum[i];
+			weightSum += edepWeightSum[i];
+		}
+		zeroWeight = sum > 0 ? weightSum / sum : 0;
+	}
 	G4bool effectiveEvent= false;
 	for (int i = 0; i < NUM_CHANNELS; i++) {
 		if (edepSum[i] > 0) {
-			hEdepSum->Fill(edepSum[i]);
+			// energy weighted mean of the weights of the tracks that
+			// deposited in the channel, the event weight without biasing
+			G4double w = edepWeightSum[i] / edepSum[i];
+			channelWeight[i] = w;
+			hEdepSum->Fill(edepSum[i], w);
 			// hd[i]->Fill(edepSum[i]);
 			effectiveEvent= true;
-			G4double sigma = GetEnergyResolution(collectedEnergySum[i]);
-			// std. Deviation of charge, in units of keV
-			// randomized the energy
-
-			edepWithoutNoise[i] = gRandom->Gaus(collectedEnergySum[i], sigma);
-			// charge
-			//	PAIR_CREATION_ENERGY /1000;
-			//  convert back to keV, we randomize it to
-			//  smear the energy resolution
-			//
-			collectedEdepSumRealistic[i] = gRandom->Gaus(edepWithoutNoise[i], ENOISE);
-			// we asssue the electronics noise
+			// charge smeared with the Fano statistics, then with the
+			// electronics noise
+			fResponse->Digitize(collectedEnergySum[i], fRandom,
+					edepWithoutNoise[i], collectedEdepSumRealistic[i]);
 
 			detectorID = i / 12;
 			pixelID = i % 12;
-			hpc->Fill(i);
-			hdc->Fill(detectorID);
+			hpc->Fill(i, w);
+			hdc->Fill(detectorID, w);
 
-			if (collectedEdepSumRealistic[i] > threshold) {
+			if (collectedEdepSumRealistic[i] > fResponse->GetThreshold()) {
 				nHits[detectorID]++;
 			}
-			sci[i] = getScienceBin(collectedEdepSumRealistic[i]);
+			sci[i] = GetScienceChannel(collectedEdepSumRealistic[i]);
 
-			hEdep[detectorID]->Fill(edepSum[i]);
-			hReal[detectorID]->Fill(collectedEdepSumRealistic[i]);
+			hEdep[detectorID]->Fill(edepSum[i], w);
+			hReal[detectorID]->Fill(collectedEdepSumRealistic[i], w);
 			// not binned to stix
-			hEdep[32]->Fill(edepSum[i]);
-			hReal[32]->Fill(collectedEdepSumRealistic[i]);
+			hEdep[32]->Fill(edepSum[i], w);
+			hReal[32]->Fill(collectedEdepSumRealistic[i], w);
 			// histograms to store spectra of events of all detectors
 
-			hEdepSci[detectorID]->Fill(edepSum[i]);
-			hRealSci[detectorID]->Fill(collectedEdepSumRealistic[i]);
+			hEdepSci[detectorID]->Fill(edepSum[i], w);
+			hRealSci[detectorID]->Fill(collectedEdepSumRealistic[i], w);
 			//
-			hEdepSci[32]->Fill(edepSum[i]);
-			hRealSci[32]->Fill(collectedEdepSumRealistic[i]);
+			hEdepSci[32]->Fill(edepSum[i], w);
+			hRealSci[32]->Fill(collectedEdepSumRealistic[i], w);
 
 			if (detectorID != 8 && detectorID != 9 && pixelID < 8) {
 				// big pixel except CFL and BKG
-				hEdepSci[33]->Fill(edepSum[i]);
-				hRealSci[33]->Fill(collectedEdepSumRealistic[i]);
+				hEdepSci[33]->Fill(edepSum[i], w);
+				hRealSci[33]->Fill(collectedEdepSumRealistic[i], w);
 			}
 			// summed spectrum
 		}
@@ -415,28 +595,31 @@ void AnalysisManager::ProcessEvent(const G4Event *event) {
 			int ch = i * 12 + j;
 			if (edepSum[ch] < 0)
 				continue;
+			// channels without deposits are filled at 0 with the event
+			// weight
+			G4double w = edepSum[ch] > 0 ? channelWeight[ch] : zeroWeight;
 
 			// hEdep[detectorID]->Fill(edepSum[i]);
 			// hReal[detectorID]->Fill(collectedEdepSumRealistic[i]);
 
-			hEdepSingleHit[i]->Fill(edepSum[ch]);
-			hRealSingleHit[i]->Fill(collectedEdepSumRealistic[ch]);
-			hEdepSciSingleHit[i]->Fill(edepSum[ch]);
-			hRealSciSingleHit[i]->Fill(collectedEdepSumRealistic[ch]);
+			hEdepSingleHit[i]->Fill(edepSum[ch], w);
+			hRealSingleHit[i]->Fill(collectedEdepSumRealistic[ch], w);
+			hEdepSciSingleHit[i]->Fill(edepSum[ch], w);
+			hRealSciSingleHit[i]->Fill(collectedEdepSumRealistic[ch], w);
 			// stix energy bins
 
-			hEdepSingleHit[32]->Fill(edepSum[ch]);
-			hRealSingleHit[32]->Fill(collectedEdepSumRealistic[ch]);
-			hEdepSciSingleHit[32]->Fill(edepSum[ch]);
-			hRealSciSingleHit[32]->Fill(collectedEdepSumRealistic[ch]);
+			hEdepSingleHit[32]->Fill(edepSum[ch], w);
+			hRealSingleHit[32]->Fill(collectedEdepSumRealistic[ch], w);
+			hEdepSciSingleHit[32]->Fill(edepSum[ch], w);
+			hRealSciSingleHit[32]->Fill(collectedEdepSumRealistic[ch], w);
 			// sum spectrum
 
 			if (j < 8 && i != 8 && i != 9) {
 
-				hEdepSingleHit[33]->Fill(edepSum[ch]);
-				hRealSingleHit[33]->Fill(collectedEdepSumRealistic[ch]);
-				hEdepSciSingleHit[33]->Fill(edepSum[ch]);
-				hRealSciSingleHit[33]->Fill(collectedEdepSumRealistic[ch]);
+				hEdepSingleHit[33]->Fill(edepSum[ch], w);
+				hRealSingleHit[33]->Fill(collectedEdepSumRealistic[ch], w);
+				hEdepSciSingleHit[33]->Fill(edepSum[ch], w);
+				hRealSciSingleHit[33]->Fill(collectedEdepSumRealistic[ch], w);
 			}
 		}
 	}
@@ -444,25 +627,36 @@ void AnalysisManager::ProcessEvent(const G4Event *event) {
 	///	hdc->Fill(detectorID);
 	// toFill=true;
 
-	if (numSourceTreeFilled < 100000)  {
-		primTree->Fill();
-		numSourceTreeFilled++;
-	}
-	//if (effectiveEvent)  evtTree->Fill();
-	isNewEvent = true;
+	FillResponseMatrices();
+
+	if (saveEvents && effectiveEvent)
+		evtTree->Fill();
+	if (saveHits && numHits > 0)
+		hitsTree->Fill();
 }
-// Stepping Action
-void AnalysisManager::UpdateParticleGunInfo() {
-	// write particle information to the tree
-	if (!isNewEvent)
+void AnalysisManager::UpdatePrimaryInfo(const G4Event *event) {
+	// primary information is taken once per event from the first primary
+	// of the first vertex, the number of primaries is kept as well
+	numPrimaries = 0;
+	eventWeight = 1;
+	for (G4int i = 0; i < event->GetNumberOfPrimaryVertex(); i++) {
+		numPrimaries += event->GetPrimaryVertex(i)->GetNumberOfParticle();
+	}
+	G4PrimaryVertex *vertex = event->GetPrimaryVertex(0);
+	G4PrimaryParticle *primary = vertex ? vertex->GetPrimary(0) : NULL;
+	if (!primary) {
+		for (int i = 0; i < 3; i++) {
+			gunPosition[i] = 0;
+			gunDirection[i] = 0;
+		}
+		gunEnergy = 0;
 		return;
-	// don't update
-
-	G4RunManager *runManager = G4RunManager::GetRunManager();
-	PrimaryGeneratorAction *primaryAction =
-		(PrimaryGeneratorAction *)runManager->GetUserPrimaryGeneratorAction();
-	G4ThreeVector position, direction;
-	primaryAction->GetGPS(position, direction, gunEnergy);
+	}
+	// weight of the biased sources, the same for all vertices of an event
+	eventWeight = vertex->GetWeight() * primary->GetWeight();
+	G4ThreeVector position = vertex->GetPosition();
+	G4ThreeVector direction = primary->GetMomentumDirection();
+	gunEnergy = primary->GetKineticEnergy() / keV;
 
 	gunPosition[0] = position.getX() / mm;
 	gunPosition[1] = position.getY() / mm;
@@ -470,81 +664,122 @@ void AnalysisManager::UpdateParticleGunInfo() {
 	gunDirection[0] = direction.getX();
 	gunDirection[1] = direction.getY();
 	gunDirection[2] = direction.getZ();
-	isNewEvent = false;
 }
 
-G4double AnalysisManager::GetNearSurfaceFactor(G4ThreeVector &pos) {
-	G4double xx = pos.x() / mm;
-	G4double z = abs(xx - CdTe_SURFACE_X); // depth from cathode
-	G4double factor = 1 - NEAR_SURFACE_R0 * exp(-z / NEAR_SURFACE_L);
-	hNS->Fill(factor);
-	return factor;
+void AnalysisManager::BookResponseMatrices() {
+	if (responseBins <= 0) {
+		hResponseE0 = NULL;
+		return;
+	}
+	hResponseE0 = new TH1F("hResponseE0",
+			"Primaries; Photon energy (keV); Counts", responseBins, responseMin,
+			responseMax);
+	for (int i = 0; i <= NUM_CHANNELS; i++) {
+		TString name = i < NUM_CHANNELS ? TString(Form("%d", i)) : TString("Sum");
+		TString title = i < NUM_CHANNELS ? TString(Form("pixel %d", i))
+			: TString("all pixels");
+		hResponseEdep[i] = new TH2F(Form("hResponseEdep%s", name.Data()),
+				Form("Response, deposited energy (%s); Photon energy (keV); "
+					"Energy deposition (keV)",
+					title.Data()),
+				responseBins, responseMin, responseMax, responseBins,
+				responseMin, responseMax);
+		hResponseReal[i] = new TH2F(Form("hResponseReal%s", name.Data()),
+				Form("Response, recorded energy (%s); Photon energy (keV); "
+					"Recorded energy (keV)",
+					title.Data()),
+				responseBins, responseMin, responseMax, responseBins,
+				responseMin, responseMax);
+	}
 }
-G4double AnalysisManager::ComputeCollectionEfficiency(G4ThreeVector &pos) {
-	// Hecht equation, see "Recent Progress in CdTe and CdZnTe Detectors"
-	// Tadayuki Takahashi and Shin Watanabe
-	// Oliver's paper
-	// Energy must be in units of eV
-	// Spectral signature of near-surface damage in CdTe X-ray detectors
-	//
-	G4double xx = pos.x() / mm;
-	// G4cout<<xx<<G4endl;
-	G4double z = abs(xx - CdTe_SURFACE_X); // depth from cathode
-										   //
-	hz->Fill(z);
-
-	G4double freePathElectron = 1100 * 100 * 3e-6 * highVoltage;
-	G4double freePathHoles = 100 * 100 * 2e-6 * highVoltage;
 
-	G4double d = 1;
-
-	G4double eff =
-		(1 - exp((z - d) / freePathElectron)) * (freePathElectron / d) +
-		(freePathHoles / d) * (1.0 - exp(-z / freePathHoles));
+void AnalysisManager::FillResponseMatrices() {
+	// called by FillPixelSums once the recorded energies are computed, the
+	// primaries are counted by ProcessEvent
+	if (!hResponseE0)
+		return;
+	for (int i = 0; i < NUM_CHANNELS; i++) {
+		if (edepSum[i] <= 0)
+			continue;
+		G4double w = channelWeight[i];
+		// the threshold is applied to the energy on each axis, so the
+		// deposited matrix is free of the detector effects
+		if (edepSum[i] > fResponse->GetThreshold()) {
+			hResponseEdep[i]->Fill(gunEnergy, edepSum[i], w);
+			hResponseEdep[NUM_CHANNELS]->Fill(gunEnergy, edepSum[i], w);
+		}
+		if (collectedEdepSumRealistic[i] > fResponse->GetThreshold()) {
+			hResponseReal[i]->Fill(gunEnergy, collectedEdepSumRealistic[i], w);
+			hResponseReal[NUM_CHANNELS]->Fill(gunEnergy,
+					collectedEdepSumRealistic[i], w);
+		}
+	}
+}
 
-	hcol->Fill(eff);
+G4double AnalysisManager::GetNearSurfaceFactor(G4double z, G4double weight) {
+	G4double factor = fResponse->GetNearSurfaceFactor(z);
+	hNS->Fill(factor, weight);
+	return factor;
+}
+G4double AnalysisManager::ComputeCollectionEfficiency(G4double z,
+		G4double weight) {
+	hz->Fill(z, weight);
+	G4double eff = fResponse->GetCollectionEfficiency(z);
+	hcol->Fill(eff, weight);
 	return eff;
 }
 
 G4double AnalysisManager::GetEnergyResolution(G4double edep) {
-	//	Recent Progress in CdTe and CdZnTe Detectors
-	// Tadayuki Takahashi and Shin Watanabe
 	// energy in units of keV
-	//
-	/*	G4double rho = 0;
-		if (edep > 0) {
-		G4double numPairs = edep / PAIR_CREATION_ENERGY * 1000;
-	// keV to ev
-	//  see oliver's paper
-	G4double numSigma2 = FANO_FACTOR * numPairs;
-	// sigma^2 = fano * n  according to the text-book
-	rho = sqrt(numSigma2) / numPairs;
-	}
-	return rho;
-	The above is equv. to  delta_E=2.35 sqrt(FWE), see
-https://www.sciencedirect.com/topics/neuroscience/fano-factor
-*/
-	//return 2.35 * sqrt(FANO_FACTOR * PAIR_CREATION_ENERGY * edep);
-	return sqrt(FANO_FACTOR * PAIR_CREATION_ENERGY * edep);
+	return fResponse->GetEnergyResolution(edep);
 }
 
 ////////////////////////////////////////////////////////////////////
 
-inline void AnalysisManager::AddEnergy(G4int detId, G4double edep) {
-	if (detId > NUM_CHANNELS || detId < 0) {
+void AnalysisManager::AddEnergy(G4int detId, G4double edep, G4double weight) {
+	if (detId >= NUM_CHANNELS || detId < 0) {
 		G4cout << "invalid index" << G4endl;
 		return;
 	}
+	if (importanceSplitting) {
+		CopySums &sums = copySums[currentCopy];
+		sums.edep[detId] += edep;
+		sums.edepWeight[detId] += edep * weight;
+		return;
+	}
 	edepSum[detId] += edep;
+	edepWeightSum[detId] += edep * weight;
 }
-inline void AnalysisManager::AddCollectedEnergy(G4int detId, G4double dep) {
-	if (detId > NUM_CHANNELS || detId < 0) {
+void AnalysisManager::AddCollectedEnergy(G4int detId, G4double dep) {
+	if (detId >= NUM_CHANNELS || detId < 0) {
 		G4cout << "invalid index" << G4endl;
 		return;
 	}
+	if (importanceSplitting) {
+		copySums[currentCopy].collected[detId] += dep;
+		return;
+	}
 	collectedEnergySum[detId] += dep;
 }
 
+void AnalysisManager::RecordHit(G4int detId, G4double depth,
+		G4double edep, G4double time, G4double weight) {
+	if (!saveHits)
+		return;
+	if (numHits >= MAX_HITS) {
+		numHitsDropped++;
+		hitsTruncated = true;
+		return;
+	}
+	rawPixel[numHits] = detId;
+	rawDepth[numHits] = depth;
+	rawEdep[numHits] = edep;
+	rawTime[numHits] = time;
+	rawWeight[numHits] = weight;
+	rawCopy[numHits] = currentCopy;
+	numHits++;
+}
+
 AnalysisManager::~AnalysisManager() {
 	if (fManager)
 		delete fManager;
@@ -558,10 +793,16 @@ void AnalysisManager::CloseROOT() {
 	inpTree->Write();
 	primTree->Write();
 	physTree->Write();
+	if (phspTree->GetEntries() > 0)
+		phspTree->Write();
+	if (hitsTree->GetEntries() > 0)
+		hitsTree->Write();
 	TDirectory *cdhist = rootFile->mkdir("hist");
 	cdhist->cd();
-	c1->cd();
-	c1->Divide(2, 5);
+	if (c1) {
+		c1->cd();
+		c1->Divide(2, 5);
+	}
 
 	for (int i = 0; i < 34; i++) {
 
@@ -588,66 +829,110 @@ void AnalysisManager::CloseROOT() {
 	h2xy->Write();
 	hdc->Write();
 	hpc->Write();
-	c1->Write();
+	if (c1)
+		c1->Write();
 	hz->Write();
 	hcol->Write();
 	hNS->Write();
+	hNumEvents->Write();
+	if (hResponseE0) {
+		TDirectory *cdresponse = rootFile->mkdir("response");
+		cdresponse->cd();
+		hResponseE0->Write();
+		for (int i = 0; i <= NUM_CHANNELS; i++) {
+			hResponseEdep[i]->Write();
+			hResponseReal[i]->Write();
+		}
+	}
 	G4cout << ">> Number of event recorded:" << evtTree->GetEntries() << G4endl;
 	G4cout << ">> Number of incident particles :" << inpTree->GetEntries()
 		<< G4endl;
 	G4cout << ">> Number of track killed:" << numKilled << G4endl;
+	if (numHitsDropped > 0) {
+		G4cout << ">> Hits beyond " << MAX_HITS
+			<< " per event not stored: " << numHitsDropped << G4endl;
+	}
+	if (G4Threading::IsWorkerThread()) {
+		rootFile->Close();
+		G4AutoLock lock(&workerFilesMutex);
+		fWorkerFiles.push_back(threadOutputFilename);
+		return;
+	}
 	CopyMacrosToROOT(rootFile, macroFilename);
 
 	rootFile->Close();
 }
 
-void AnalysisManager::ProcessStep(const G4Step *aStep) {
-
-	UpdateParticleGunInfo();
-
-	G4double px, py, pz;
-	G4double edep;
-	G4String volName;
-	const G4Track *track = aStep->GetTrack();
-
-	if (track->GetVolume())
-		volName = track->GetVolume()->GetName();
-
-
-	if (volName=="detector") { // don't store too many tracks
-		FillDetectorIncidentParticle(aStep);
-		aStep->GetTrack()->SetTrackStatus(fKillTrackAndSecondaries);
-		numKilled++;
+void AnalysisManager::MergeWorkerOutputs() {
+	// called by the master after all workers have closed their files
+	G4AutoLock lock(&workerFilesMutex);
+	G4cout << ">> Merging " << fWorkerFiles.size() << " worker outputs into "
+		<< outputFilename << G4endl;
+	if (!MergeOutputFiles(fWorkerFiles, outputFilename)) {
+		G4cout << "Failed to merge worker outputs, temporary files are kept"
+			<< G4endl;
+		return;
 	}
-		//dummy detector, material as black hole
-		//used to study grid effect
-
-	
-
-
-
-
-
+	TFile *f = new TFile(outputFilename.Data(), "update");
+	CopyMacrosToROOT(f, macroFilename);
+	f->Close();
+	delete f;
+	for (size_t i = 0; i < fWorkerFiles.size(); i++) {
+		gSystem->Unlink(fWorkerFiles[i].Data());
+	}
+	fWorkerFiles.clear();
+}
 
+void AnalysisManager::ProcessDetectorPlaneHit(const G4Step *aStep) {
+	// called by DetectorPlaneSD, the detector is a black hole
+	// used to study grid effect
+	FillDetectorIncidentParticle(aStep);
+	aStep->GetTrack()->SetTrackStatus(fKillTrackAndSecondaries);
+	numKilled++;
+}
+void AnalysisManager::FillDetectorMap(const G4ThreeVector &pos,
+		G4double weight) {
+	// the detector plane is normal to z, centered on the axis
+	h2xy->Fill(pos.x() / mm, pos.y() / mm, weight);
+}
+void AnalysisManager::FillPhaseSpace(const G4Step *aStep) {
+	G4StepPoint *preStep = aStep->GetPreStepPoint();
+	const G4Track *track = aStep->GetTrack();
+	G4ThreeVector pos = preStep->GetPosition();
+	G4ThreeVector dir = preStep->GetMomentumDirection();
+	phspPDG = track->GetDefinition()->GetPDGEncoding();
+	phspEnergy = preStep->GetKineticEnergy() / keV;
+	phspPos[0] = pos.x() / mm;
+	phspPos[1] = pos.y() / mm;
+	phspPos[2] = pos.z() / mm;
+	phspDir[0] = dir.x();
+	phspDir[1] = dir.y();
+	phspDir[2] = dir.z();
+	phspWeight = preStep->GetWeight();
+	phspTree->Fill();
 }
 void AnalysisManager::FillDetectorIncidentParticle(const G4Step *aStep)
 {
 
 	G4StepPoint *preStep = aStep->GetPreStepPoint();
-	G4StepPoint *postStep = aStep->GetPostStepPoint();
 	inpEnergy = preStep->GetKineticEnergy() / keV;
+	G4ThreeVector prePos = preStep->GetPosition();
+	// the pre step point is on the surface of the detector
 	const G4Track *track = aStep->GetTrack();
-	G4ThreeVector prePos = postStep->GetPosition();
+	inpPDG = track->GetDefinition()->GetPDGEncoding();
+	parentID = track->GetParentID();
 
 	G4double px, py, pz;
 	// G4cout<<"filling2 "<<G4endl;
 	px = prePos.x() / mm;
 	py = prePos.y() / mm;
 	pz = prePos.z() / mm;
-	h2xy->Fill(py - PY_ORIGIN, pz - PZ_ORIGIN);
+	// not 1 when the photons were split or played Russian roulette
+	inpWeight = preStep->GetWeight();
+	FillDetectorMap(prePos, inpWeight);
 
 	//if (numInpTreeFilled < MAX_NUM_TREE_TO_FILL) {
-		G4ThreeVector inpV = track->GetMomentumDirection();
+		G4ThreeVector inpV = preStep->GetMomentumDirection();
 		inpVec[0] = inpV.x();
 		inpVec[1] = inpV.y();
 		inpVec[2] = inpV.z();
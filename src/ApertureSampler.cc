@@ -0,0 +1,93 @@
+/***************************************************************
+ * Source positions biased towards the slit apertures
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "ApertureSampler.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#include "DetectorConstruction.hh"
+#include "G4RunManager.hh"
+#include "Randomize.hh"
+
+ApertureSampler::ApertureSampler(G4double biasedFraction)
+    : fBiasedFraction(biasedFraction) {
+  const DetectorConstruction *detector =
+      dynamic_cast<const DetectorConstruction *>(
+          G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector) {
+    G4Exception("ApertureSampler::ApertureSampler()", "Gen004",
+                FatalException, "Aperture biasing needs the slit plate");
+  }
+  fPitch = detector->GetSlitPitch();
+  fWidth = detector->GetSlitWidth();
+  fNumSlits = detector->GetNumberOfSlits();
+  // see DetectorConstruction::ConstructTungstenPlate
+  fFirstCenter = -detector->GetPlateHalfWidth() + fPitch / 2;
+  fFrontZ = -detector->GetPlateHalfDepth();
+}
+
+G4double ApertureSampler::GetOverlap(G4int i, G4double lo,
+                                     G4double hi) const {
+  G4double center = fFirstCenter + i * fPitch;
+  return std::max(0.0, std::min(hi, center + fWidth / 2) -
+                           std::max(lo, center - fWidth / 2));
+}
+
+G4double ApertureSampler::GetOpenLength(G4double lo, G4double hi,
+                                        G4int &first, G4int &last) const {
+  G4double halfWidth = fWidth / 2;
+  first = (G4int)std::floor((lo - halfWidth - fFirstCenter) / fPitch) + 1;
+  last = (G4int)std::ceil((hi + halfWidth - fFirstCenter) / fPitch) - 1;
+  first = std::max(first, 0);
+  last = std::min(last, fNumSlits - 1);
+  if (first > last)
+    return 0;
+  // only the slits at the ends can be partly outside
+  G4double length = GetOverlap(first, lo, hi);
+  if (last > first)
+    length += GetOverlap(last, lo, hi) + (last - first - 1) * fWidth;
+  return length;
+}
+
+G4bool ApertureSampler::IsOpen(G4double x) const {
+  G4int i = (G4int)std::floor((x - fFirstCenter) / fPitch + 0.5);
+  if (i < 0 || i >= fNumSlits)
+    return false;
+  return std::fabs(x - fFirstCenter - i * fPitch) <= fWidth / 2;
+}
+
+G4double ApertureSampler::Sample(G4ThreeVector &pos, const G4ThreeVector &dir,
+                                 G4double xMin, G4double xMax) const {
+  if (dir.z() <= 0 || pos.z() >= fFrontZ || xMax <= xMin)
+    return 1;
+  // x on the front face of the plate, the shift is the same for the whole
+  // source plane
+  G4double shift = dir.x() / dir.z() * (fFrontZ - pos.z());
+  G4double lo = xMin + shift;
+  G4double hi = xMax + shift;
+  G4int first, last;
+  G4double openLength = GetOpenLength(lo, hi, first, last);
+  if (openLength <= 0)
+    return 1;
+
+  G4double x = pos.x() + shift;
+  if (G4UniformRand() < fBiasedFraction) {
+    // uniform over the open parts of [lo, hi], only the slits at the ends
+    // can be rejected
+    do {
+      G4int i = first + (G4int)((last - first + 1) * G4UniformRand());
+      i = std::min(i, last);
+      x = fFirstCenter + i * fPitch + (G4UniformRand() - 0.5) * fWidth;
+    } while (x < lo || x > hi);
+  }
+  G4double uniform = 1 / (hi - lo);
+  G4double density = (1 - fBiasedFraction) * uniform;
+  if (IsOpen(x))
+    density += fBiasedFraction / openLength;
+  pos.setX(x - shift);
+  return uniform / density;
+}
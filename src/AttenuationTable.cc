@@ -0,0 +1,122 @@
+/***************************************************************
+ * Photon attenuation coefficients of the materials
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "AttenuationTable.hh"
+
+#include <cmath>
+
+#include "G4AtomicShells.hh"
+#include "G4AtomicTransitionManager.hh"
+#include "G4Element.hh"
+#include "G4EmCalculator.hh"
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+
+namespace {
+const char *gammaProcesses[4] = {"phot", "compt", "Rayl", "conv"};
+
+G4double ComputeAttenuation(G4EmCalculator &calc, const G4Material *mat,
+                            G4double energy, G4double &photo) {
+  G4double total = 0;
+  photo = 0;
+  for (int i = 0; i < 4; i++) {
+    G4double mu = calc.ComputeCrossSectionPerVolume(energy, "gamma",
+                                                    gammaProcesses[i], mat);
+    if (i == 0)
+      photo = mu;
+    total += mu;
+  }
+  return total;
+}
+} // namespace
+
+AttenuationTable::AttenuationTable(G4double minEnergy, G4double maxEnergy,
+                                   G4int numPoints)
+    : fLogMinEnergy(std::log(minEnergy)),
+      fLogStep(std::log(maxEnergy / minEnergy) / (numPoints - 1)),
+      fNumPoints(numPoints) {}
+
+AttenuationTable::~AttenuationTable() {}
+
+const AttenuationTable::MaterialData &
+AttenuationTable::GetData(const G4Material *mat) {
+  std::map<const G4Material *, MaterialData>::iterator it = fData.find(mat);
+  if (it != fData.end())
+    return it->second;
+
+  G4EmCalculator calc;
+  MaterialData &data = fData[mat];
+  data.attenuation.resize(fNumPoints);
+  data.photoFraction.resize(fNumPoints);
+  for (G4int i = 0; i < fNumPoints; i++) {
+    G4double energy = std::exp(fLogMinEnergy + i * fLogStep);
+    G4double photo;
+    G4double mu = ComputeAttenuation(calc, mat, energy, photo);
+    data.attenuation[i] = mu;
+    data.photoFraction[i] = mu > 0 ? photo / mu : 0;
+  }
+
+  // only the heaviest element fluoresces, the plate is pure tungsten
+  const G4Element *heaviest = NULL;
+  for (size_t i = 0; i < mat->GetNumberOfElements(); i++) {
+    const G4Element *el = mat->GetElement(i);
+    if (!heaviest || el->GetZ() > heaviest->GetZ())
+      heaviest = el;
+  }
+  data.kEdge = DBL_MAX;
+  data.kProbability = 0;
+  data.kAlphaEnergy = 0;
+  G4int Z = heaviest ? (G4int)heaviest->GetZ() : 0;
+  if (Z > 5) {
+    data.kEdge = G4AtomicShells::GetBindingEnergy(Z, 0);
+    data.kAlphaEnergy = data.kEdge - G4AtomicShells::GetBindingEnergy(Z, 3);
+    // the fraction of photoabsorptions on the K shell is 1 - 1/J, with the
+    // jump ratio J of the photoelectric cross section at the edge
+    G4double below, above;
+    ComputeAttenuation(calc, mat, data.kEdge * 0.999, below);
+    ComputeAttenuation(calc, mat, data.kEdge * 1.001, above);
+    G4double yield = G4AtomicTransitionManager::Instance()
+                         ->TotalRadiativeTransitionProbability(Z, 0);
+    if (above > below && below > 0)
+      data.kProbability = (1 - below / above) * yield;
+  }
+  G4cout << "Attenuation table of " << mat->GetName() << ": K edge "
+         << data.kEdge / keV << " keV, K alpha " << data.kAlphaEnergy / keV
+         << " keV, probability " << data.kProbability << G4endl;
+  return data;
+}
+
+G4double AttenuationTable::Interpolate(const std::vector<G4double> &values,
+                                       G4double energy) {
+  G4double x = (std::log(energy) - fLogMinEnergy) / fLogStep;
+  if (x <= 0)
+    return values[0];
+  if (x >= fNumPoints - 1)
+    return values[fNumPoints - 1];
+  G4int i = (G4int)x;
+  G4double f = x - i;
+  return values[i] * (1 - f) + values[i + 1] * f;
+}
+
+G4double AttenuationTable::GetAttenuation(const G4Material *mat,
+                                          G4double energy) {
+  return Interpolate(GetData(mat).attenuation, energy);
+}
+
+G4double AttenuationTable::GetPhotoFraction(const G4Material *mat,
+                                            G4double energy) {
+  return Interpolate(GetData(mat).photoFraction, energy);
+}
+
+G4double AttenuationTable::GetFluorescenceProbability(const G4Material *mat,
+                                                      G4double energy) {
+  const MaterialData &data = GetData(mat);
+  return energy > data.kEdge ? data.kProbability : 0;
+}
+
+G4double AttenuationTable::GetFluorescenceEnergy(const G4Material *mat) {
+  return GetData(mat).kAlphaEnergy;
+}
@@ -0,0 +1,125 @@
+/***************************************************************
+ * Fast simulation of photons in the tungsten plate
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "CollimatorFastModel.hh"
+
+#include <cmath>
+
+#include "AttenuationTable.hh"
+#include "DetectorConstruction.hh"
+#include "G4DynamicParticle.hh"
+#include "G4Gamma.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Navigator.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4RandomDirection.hh"
+#include "G4Region.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "Randomize.hh"
+
+CollimatorFastModel::CollimatorFastModel(const G4String &name,
+                                         G4Region *envelope,
+                                         DetectorConstruction *detector)
+    : G4VFastSimulationModel(name, envelope), fEnvelope(envelope),
+      fDetector(detector) {
+  fNavigator = new G4Navigator();
+  fTable = new AttenuationTable(1 * keV, 1 * MeV, 2000);
+}
+
+CollimatorFastModel::~CollimatorFastModel() {
+  delete fNavigator;
+  delete fTable;
+}
+
+G4bool CollimatorFastModel::IsApplicable(const G4ParticleDefinition &particle) {
+  return &particle == G4Gamma::Gamma();
+}
+
+G4bool CollimatorFastModel::ModelTrigger(const G4FastTrack &fastTrack) {
+  if (!fDetector->GetFastSimEnabled())
+    return false;
+  if (fastTrack.GetPrimaryTrack()->GetKineticEnergy() >
+      fDetector->GetFastSimMaxEnergy())
+    return false;
+  // only photons entering the envelope, photons created inside it (the
+  // fluorescence of this model among them) are tracked normally
+  const G4VSolid *solid = fastTrack.GetEnvelopeSolid();
+  G4ThreeVector pos = fastTrack.GetPrimaryTrackLocalPosition();
+  G4ThreeVector dir = fastTrack.GetPrimaryTrackLocalDirection();
+  return solid->Inside(pos) == kSurface &&
+         solid->SurfaceNormal(pos).dot(dir) < 0;
+}
+
+void CollimatorFastModel::DoIt(const G4FastTrack &fastTrack,
+                               G4FastStep &fastStep) {
+  const G4Track *track = fastTrack.GetPrimaryTrack();
+  G4double energy = track->GetKineticEnergy();
+  G4ThreeVector pos = track->GetPosition();
+  G4ThreeVector dir = track->GetMomentumDirection();
+
+  if (fNavigator->GetWorldVolume() == NULL) {
+    fNavigator->SetWorldVolume(G4TransportationManager::GetTransportationManager()
+                                   ->GetNavigatorForTracking()
+                                   ->GetWorldVolume());
+  }
+
+  // walk the straight line volume by volume until the sampled number of
+  // mean free paths is used up or the photon leaves the envelope
+  G4double freePaths = -std::log(1 - G4UniformRand());
+  G4double pathLength = 0;
+  const G4Material *interactionMaterial = NULL;
+  G4VPhysicalVolume *pv =
+      fNavigator->LocateGlobalPointAndSetup(pos, &dir, false, false);
+  for (int i = 0; i < 100000 && pv; i++) {
+    if (pv->GetLogicalVolume()->GetRegion() != fEnvelope)
+      break;
+    G4double safety;
+    G4double step = fNavigator->ComputeStep(pos, dir, kInfinity, safety);
+    if (step == kInfinity)
+      break;
+    const G4Material *mat = pv->GetLogicalVolume()->GetMaterial();
+    G4double mu = fTable->GetAttenuation(mat, energy);
+    if (mu * step >= freePaths) {
+      step = freePaths / mu;
+      pos += step * dir;
+      pathLength += step;
+      interactionMaterial = mat;
+      break;
+    }
+    freePaths -= mu * step;
+    pos += step * dir;
+    pathLength += step;
+    fNavigator->SetGeometricallyLimitedStep();
+    pv = fNavigator->LocateGlobalPointAndSetup(pos, &dir, true, false);
+  }
+
+  G4double time = track->GetGlobalTime() + pathLength / c_light;
+  if (!interactionMaterial) {
+    // transmitted, full tracking continues from the exit point
+    fastStep.ProposePrimaryTrackFinalPosition(pos, false);
+    fastStep.ProposePrimaryTrackFinalTime(time);
+    fastStep.ProposePrimaryTrackPathLength(pathLength);
+    return;
+  }
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(pathLength);
+  G4double deposit = energy;
+  G4double photoFraction = fTable->GetPhotoFraction(interactionMaterial, energy);
+  G4double kProbability =
+      fTable->GetFluorescenceProbability(interactionMaterial, energy);
+  if (G4UniformRand() < photoFraction * kProbability) {
+    G4double lineEnergy = fTable->GetFluorescenceEnergy(interactionMaterial);
+    fastStep.SetNumberOfSecondaryTracks(1);
+    G4DynamicParticle photon(G4Gamma::Gamma(), G4RandomDirection(),
+                             lineEnergy);
+    fastStep.CreateSecondaryTrack(photon, pos, time, false);
+    deposit -= lineEnergy;
+  }
+  fastStep.ProposeTotalEnergyDeposited(deposit);
+}
@@ -23,24 +23,40 @@
 #include <G4PVReplica.hh>
 #include <G4Polycone.hh>
 #include <G4Polyhedra.hh>
+#include <G4Region.hh>
+#include <G4RegionStore.hh>
 #include <G4RotationMatrix.hh>
 #include <G4RunManager.hh>
+#include <G4SDManager.hh>
 #include <G4SolidStore.hh>
 #include <G4SubtractionSolid.hh>
 #include <G4ThreeVector.hh>
+#include <G4Timer.hh>
 #include <G4Transform3D.hh>
 #include <G4Tubs.hh>
 #include <G4TwoVector.hh>
 #include <G4UImanager.hh>
 #include <G4UnionSolid.hh>
 #include <G4VisAttributes.hh>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <vector>
 
 #include "AnalysisManager.hh"
+#include "CollimatorFastModel.hh"
+#include "DetectorPlaneSD.hh"
+#include "Fingerprint.hh"
 #include "G4ExtrudedSolid.hh"
 #include "G4NistManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4VisAttributes.hh"
+#include "PhaseSpaceSD.hh"
+#include "PixelSD.hh"
 #include "globals.hh"
 const G4double pi = CLHEP::pi;
 const G4ThreeVector singleDetectorPosition(0, 0, -0.8 * mm);
@@ -57,6 +73,16 @@ const G4double pixel4CenterY = -2.3 * mm;
 const G4double deltaW = 2.2 * mm;
 const G4double pixel8CenterX = -3.85 * mm;
 const G4double pixel8CenterY = 0 * mm;
+// world and detector box of ConstructWorld, part of the geometry hash
+const G4double worldHalfSize = 50 * cm;
+const G4double detectorZ = 41.5 * cm;
+const G4double detectorHalfDepth = 10 * mm;
+// part of the GDML cache key with the digest of the geometry sources,
+// which CMake computes; bump it when the cache format changes
+const char *const geometryVersion = "g4lisa-geometry-3";
+#ifndef GEOMETRY_SOURCE_HASH
+#define GEOMETRY_SOURCE_HASH "unknown"
+#endif
 
 const G4double cdteThickness = 1 * mm;
 const G4double anodeThickness = (15 + 15 + 100) * 1e-9 * m;  // 130 nm
@@ -96,9 +122,22 @@ padTotalThickness + pinsThickness + padCdTeBondingThickness;
 DetectorConstruction::DetectorConstruction() {
 	// G4endl;
 	fWorldFile = "";
+	gdmlCacheDir = "";
+	fastSimEnabled = false;
+	fastSimMaxEnergy = 200 * keV;
+	importanceLayers = 0;
+	importanceRatio = 2;
+	phspEnabled = false;
+	phspZ = 0;
 	//tungstenGridThickness=TungstenGridDefaultThickness;
 	checkOverlaps = true;
 
+	plateHalfWidth = 50 * mm;
+	plateHalfDepth = 15 * mm;
+	slitPitch = 0.2 * mm;
+	slitWidth = 0.1 * mm;
+	numSlits = 0;
+
 	detMsg = new DetectorMessenger(this);
 
 }
@@ -470,9 +509,144 @@ G4LogicalVolume *DetectorConstruction::ConstructCaliste() {
 
 DetectorConstruction::~DetectorConstruction() { delete detMsg; }
 
+G4LogicalVolume *DetectorConstruction::ConstructTungstenPlate() {
+	// periodic vacuum slits in a tungsten plate, built as a replica of
+	// identical cells, each cell is tungsten with a slit in the center
+	if (slitWidth >= slitPitch) {
+		G4Exception("DetectorConstruction::ConstructTungstenPlate()", "Geo001",
+				FatalException, "The slit width must be smaller than the pitch");
+	}
+	G4double arrayHalfWidth = numSlits * slitPitch / 2;
+
+	G4Box *tungstenWindow = new G4Box("TungstenWindow", plateHalfWidth,
+			plateHalfWidth, plateHalfDepth);
+	G4LogicalVolume *TungstenWindowLog = new G4LogicalVolume(tungstenWindow,
+			Tungsten, "tungstenWindow", 0, 0, 0);
+
+	G4Box *slitArray = new G4Box("SlitArray", arrayHalfWidth, plateHalfWidth,
+			plateHalfDepth);
+	G4LogicalVolume *slitArrayLog =
+		new G4LogicalVolume(slitArray, Tungsten, "slitArray", 0, 0, 0);
+	new G4PVPlacement(0, G4ThreeVector(-plateHalfWidth + arrayHalfWidth, 0, 0),
+			slitArrayLog, "SlitArray", TungstenWindowLog, false, 0,
+			checkOverlaps);
+
+	G4Box *slitCell = new G4Box("SlitCell", slitPitch / 2, plateHalfWidth,
+			plateHalfDepth);
+	G4LogicalVolume *slitCellLog =
+		new G4LogicalVolume(slitCell, Tungsten, "slitCell", 0, 0, 0);
+	new G4PVReplica("SlitCells", slitCellLog, slitArrayLog, kXAxis, numSlits,
+			slitPitch);
+
+	G4Box *tungstenPitch = new G4Box("TungstenPitch", slitWidth / 2,
+			plateHalfWidth, plateHalfDepth);
+	G4LogicalVolume *tungstenPitchLog =
+		new G4LogicalVolume(tungstenPitch, Vacuum, "tungstenPitch", 0, 0, 0);
+	new G4PVPlacement(0, G4ThreeVector(0, 0, 0), tungstenPitchLog,
+			"tungstenPitch", slitCellLog, false, 0, checkOverlaps);
+
+	G4cout << numSlits << " pitch created!" << G4endl;
+	return TungstenWindowLog;
+}
+
 G4VPhysicalVolume *DetectorConstruction::Construct() {
 	// AnalysisManager->SetAttenuatorStatus(attenuatorIn);
+	G4Timer timer;
+	timer.Start();
+
+	DefineMaterials();
+	numSlits = (G4int)floor(2 * plateHalfWidth / slitPitch + 1e-9) - 1;
+	// the last pitch of the plate is solid tungsten
+
+	G4bool cached = false;
+	if (gdmlCacheDir != "") {
+		// the cache file is keyed by the geometry parameters and materials
+		fWorldFile = gdmlCacheDir + "/world_" + ComputeGeometryHash() + ".gdml";
+		cached = ReadGeometryCache();
+	}
+	if (!cached) {
+		ConstructWorld();
+		if (gdmlCacheDir != "")
+			WriteGeometryCache();
+	}
+	ConstructRegions();
+
+	SetVisColors();
+	worldLogical->SetVisAttributes(G4VisAttributes(false));
+	timer.Stop();
+	G4cout << "World construction completed in " << timer.GetRealElapsed()
+		<< " s" << G4endl;
+	return worldPhysical;
+}
+
+G4String DetectorConstruction::ComputeGeometryHash() {
+	// the cache version, the digest of the geometry sources, the
+	// parameters, the fixed dimensions and every material in the table
+	std::ostringstream desc;
+	desc << std::setprecision(17) << geometryVersion << " "
+		<< GEOMETRY_SOURCE_HASH << " " << plateHalfWidth
+		<< " " << plateHalfDepth << " " << slitPitch << " " << slitWidth << " "
+		<< phspEnabled << " " << phspZ << " " << worldHalfSize << " "
+		<< detectorZ << " " << detectorHalfDepth << "\n";
+	DescribeMaterials(desc);
+	return HashToHex(desc.str());
+}
+
+G4bool DetectorConstruction::ReadGeometryCache() {
+	std::ifstream cacheFile(fWorldFile.c_str());
+	if (!cacheFile.good()) {
+		G4cout << ">>Geometry cache " << fWorldFile << " not found" << G4endl;
+		return false;
+	}
+	cacheFile.close();
+	G4cout << ">>Reading geometry from cache " << fWorldFile
+		<< ", overlap checks skipped" << G4endl;
+	// the file has no materials section, the volumes refer to the materials
+	// of DefineMaterials by name. Reading them again would define a second
+	// material of every name and change the material table, and with it
+	// the physics table fingerprint, between a cache miss and a hit
+	G4GDMLParser parser;
+	parser.Read(fWorldFile, false);
+	worldPhysical = parser.GetWorldVolume();
+	if (!worldPhysical)
+		return false;
+	worldLogical = worldPhysical->GetLogicalVolume();
+	return true;
+}
 
+void DetectorConstruction::WriteGeometryCache() {
+	// written to a temporary file first, several processes may start with
+	// the same geometry at the same time
+	G4String tmpFile = fWorldFile;
+	tmpFile.erase(tmpFile.size() - 5);
+	tmpFile += "." + std::to_string(getpid()) + ".gdml";
+	G4GDMLParser parser;
+	parser.Write(tmpFile, worldPhysical, false);
+	// without refs the names are those of the material table, so the
+	// materials section is dropped and the reader resolves them there
+	std::string gdml;
+	{
+		std::ifstream in(tmpFile.c_str());
+		std::ostringstream content;
+		content << in.rdbuf();
+		gdml = content.str();
+	}
+	size_t begin = gdml.find("<materials>");
+	size_t end = gdml.find("</materials>");
+	if (begin != std::string::npos && end != std::string::npos) {
+		gdml.erase(begin, end + std::string("</materials>").size() - begin);
+		std::ofstream out(tmpFile.c_str());
+		out << gdml;
+	}
+	if (rename(tmpFile.c_str(), fWorldFile.c_str()) != 0) {
+		G4cout << "Can not write geometry cache " << fWorldFile << G4endl;
+		remove(tmpFile.c_str());
+		return;
+	}
+	G4cout << ">>Geometry written to cache " << fWorldFile << G4endl;
+}
+
+void DetectorConstruction::DefineMaterials() {
 	G4NistManager *nist = G4NistManager::Instance();
 	Alum = nist->FindOrBuildMaterial("G4_Al");
 	Vacuum = nist->FindOrBuildMaterial("G4_Galactic");
@@ -626,9 +800,12 @@ G4Material* aluminium6061Mat = new G4Material("aluminium6061", 2.70 * g/cm3, 8);
 		new G4Material("LeadPadMat", density = 11 * g / cm3, nelements = 2);
 	LeadPadMat->AddMaterial(Nickle, fractionmass = 0.587);
 	LeadPadMat->AddMaterial(Gold, fractionmass = 0.413);
+}
 
+void DetectorConstruction::ConstructWorld() {
 	// construct world
-	G4Box *worldSolid = new G4Box("worldSolid", 50 * cm, 50 * cm, 50 * cm);
+	G4Box *worldSolid = new G4Box("worldSolid", worldHalfSize, worldHalfSize,
+			worldHalfSize);
 	worldLogical =
 		new G4LogicalVolume(worldSolid, Vacuum, "worldLogical", 0, 0, 0);
 	worldPhysical = new G4PVPlacement(0, G4ThreeVector(0, 0, 0), worldLogical,
@@ -663,49 +840,109 @@ G4Material* aluminium6061Mat = new G4Material("aluminium6061", 2.70 * g/cm3, 8);
 	new G4PVPlacement(G4Transform3D(rotMatrix, pos), CalisteLog,"Caliste",
 			worldLogical, false, 0, true);
 	*/
-	G4double plateHalfWidth =50*mm;
-	G4double plateHalfDepth=15*mm;
-	G4double pitchHalfWidth=0.05*mm;
-
-	G4double detectorHalfDepth=10*mm;
-
-	G4Box *tungstenWindow= new G4Box("TungstenWindow", plateHalfWidth, plateHalfWidth, plateHalfDepth); //
-	G4LogicalVolume *TungstenWindowLog=new G4LogicalVolume(tungstenWindow, Tungsten, "tungstenWindow", 0, 0, 0);
-
+	G4LogicalVolume *TungstenWindowLog = ConstructTungstenPlate();
 	new G4PVPlacement(0, G4ThreeVector(0,0,0), TungstenWindowLog, "TungstenPlate", worldLogical,
 				false, 0, true);
 
-
-	G4Box *tungstenPitch= new G4Box("TungstenPitch", pitchHalfWidth, plateHalfWidth, plateHalfDepth); //
-	G4LogicalVolume *tungstenPitchLog=new G4LogicalVolume(tungstenPitch, Vacuum, "tungstenPitch", 0, 0, 0);
-
-	G4double px = -plateHalfWidth +2*pitchHalfWidth;
-	int i=0;
-
-	while(px<plateHalfWidth-2*pitchHalfWidth)
-	{
-		new G4PVPlacement(0, G4ThreeVector(px, 0, 0), tungstenPitchLog,
-				"tungstenPitch", TungstenWindowLog, false, i, true);
-		px+= pitchHalfWidth *4;
-		i++;
-	}
-	G4cout<<i<<" pitch created!"<<G4endl;
-
 	G4Box *detectorBox= new G4Box("detectorBox", plateHalfWidth, plateHalfWidth, detectorHalfDepth); //
 																									 //
-	G4double detectorZ=41.5*cm;
-
 	G4LogicalVolume *detectorLog=new G4LogicalVolume(detectorBox, blackHole, "detectorBox", 0, 0, 0);
 	new G4PVPlacement(0, G4ThreeVector(0,0,detectorZ), detectorLog, "detector", worldLogical,
 				false, 0, true);
 
-	SetVisColors();
-	worldLogical->SetVisAttributes(G4VisAttributes(false));
-	G4cout << "World construction completed" << G4endl;
-	return worldPhysical;
+	if (phspEnabled) {
+		// a thin vacuum plane covering the world, it must lie in the gap
+		// between the plate and the detector. Only there every particle
+		// entering it moves in +z: upstream of the plate it would also
+		// record the photons backscattered by the plate, which the replay
+		// of the forward records produces again
+		G4double phspHalfDepth = 0.5 * um;
+		if (phspZ - phspHalfDepth < plateHalfDepth ||
+				phspZ + phspHalfDepth > detectorZ - detectorHalfDepth) {
+			G4Exception("DetectorConstruction::ConstructWorld()", "Geo002",
+					FatalException,
+					"The phase space plane is not between the plate and the detector");
+		}
+		G4Box *phspBox = new G4Box("phspPlane", 49 * cm, 49 * cm, phspHalfDepth);
+		G4LogicalVolume *phspLog =
+			new G4LogicalVolume(phspBox, Vacuum, "phspPlane", 0, 0, 0);
+		new G4PVPlacement(0, G4ThreeVector(0, 0, phspZ), phspLog, "phspPlane",
+				worldLogical, false, 0, checkOverlaps);
+		G4cout << "Phase space plane at z = " << phspZ / mm << " mm" << G4endl;
+	}
+}
+
+
+void DetectorConstruction::ConstructRegions() {
+	// production cuts and range rejection are set per region by the physics
+	// list, the rest of the world stays in DefaultRegionForTheWorld.
+	// Volumes are looked up by name, so that this also works for a world
+	// read from the GDML cache
+	G4LogicalVolumeStore *lvs = G4LogicalVolumeStore::GetInstance();
+	G4RegionStore *regions = G4RegionStore::GetInstance();
+
+	G4LogicalVolume *plateLog = lvs->GetVolume("tungstenWindow", false);
+	if (plateLog && !regions->GetRegion("Collimator", false)) {
+		G4Region *collimatorRegion = new G4Region("Collimator");
+		collimatorRegion->AddRootLogicalVolume(plateLog);
+	}
+
+	const char *detectorNames[4] = {"detectorBox", "bigPixelTopLog",
+		"bigPixelBottomLog", "smallPixelLog"};
+	G4Region *detectorRegion = regions->GetRegion("Detector", false);
+	for (int i = 0; i < 4; i++) {
+		G4LogicalVolume *log = lvs->GetVolume(detectorNames[i], false);
+		if (!log)
+			continue;
+		if (!detectorRegion)
+			detectorRegion = new G4Region("Detector");
+		detectorRegion->AddRootLogicalVolume(log);
+	}
 }
 
+void DetectorConstruction::ConstructSDandField() {
+	// sensitive detectors are thread local, hits are only processed for
+	// steps in these volumes
+	G4SDManager *sdManager = G4SDManager::GetSDMpointer();
+	G4LogicalVolumeStore *lvs = G4LogicalVolumeStore::GetInstance();
+
+	G4LogicalVolume *detectorLog = lvs->GetVolume("detectorBox", false);
+	if (detectorLog) {
+		DetectorPlaneSD *planeSD = new DetectorPlaneSD("detectorPlaneSD");
+		sdManager->AddNewDetector(planeSD);
+		SetSensitiveDetector(detectorLog, planeSD);
+	}
 
+	// pixels only exist if the Caliste is constructed
+	const char *pixelNames[3] = {"bigPixelTopLog", "bigPixelBottomLog",
+		"smallPixelLog"};
+	PixelSD *pixelSD = NULL;
+	for (int i = 0; i < 3; i++) {
+		G4LogicalVolume *pixelLog = lvs->GetVolume(pixelNames[i], false);
+		if (!pixelLog)
+			continue;
+		if (!pixelSD) {
+			pixelSD = new PixelSD("pixelSD", cdteThickness);
+			sdManager->AddNewDetector(pixelSD);
+		}
+		SetSensitiveDetector(pixelLog, pixelSD);
+	}
+
+	G4LogicalVolume *phspLog = lvs->GetVolume("phspPlane", false);
+	if (phspLog) {
+		PhaseSpaceSD *phspSD = new PhaseSpaceSD("phaseSpaceSD");
+		sdManager->AddNewDetector(phspSD);
+		SetSensitiveDetector(phspLog, phspSD);
+	}
+
+	// the model is thread local as well, the physics list only registers the
+	// fast simulation process when it is enabled
+	G4Region *collimatorRegion =
+		G4RegionStore::GetInstance()->GetRegion("Collimator", false);
+	if (collimatorRegion && fastSimEnabled) {
+		new CollimatorFastModel("collimatorFastModel", collimatorRegion, this);
+	}
+}
 
 void DetectorConstruction::SetVisAttrib(G4LogicalVolume *log, G4double red,
 		G4double green, G4double blue,
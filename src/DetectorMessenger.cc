@@ -19,12 +19,132 @@
 
 DetectorMessenger::DetectorMessenger(DetectorConstruction *theDet)
     : fDetector(theDet) {
+  fDetectorDir = new G4UIdirectory("/det/");
+  fDetectorDir->SetGuidance("geometry commands");
 
+  fSetPlateDepthCmd = new G4UIcmdWithADoubleAndUnit("/det/plate/depth", this);
+  fSetPlateDepthCmd->SetGuidance("Set the depth of the tungsten plate.");
+  fSetPlateDepthCmd->SetParameterName("depth", false);
+  fSetPlateDepthCmd->SetUnitCategory("Length");
+  fSetPlateDepthCmd->SetRange("depth>0.0");
+  fSetPlateDepthCmd->AvailableForStates(G4State_PreInit);
 
+  fSetSlitPitchCmd = new G4UIcmdWithADoubleAndUnit("/det/slit/pitch", this);
+  fSetSlitPitchCmd->SetGuidance("Set the pitch of the slits.");
+  fSetSlitPitchCmd->SetParameterName("pitch", false);
+  fSetSlitPitchCmd->SetUnitCategory("Length");
+  fSetSlitPitchCmd->SetRange("pitch>0.0");
+  fSetSlitPitchCmd->AvailableForStates(G4State_PreInit);
+
+  fSetSlitWidthCmd = new G4UIcmdWithADoubleAndUnit("/det/slit/width", this);
+  fSetSlitWidthCmd->SetGuidance("Set the width of the slits.");
+  fSetSlitWidthCmd->SetParameterName("width", false);
+  fSetSlitWidthCmd->SetUnitCategory("Length");
+  fSetSlitWidthCmd->SetRange("width>0.0");
+  fSetSlitWidthCmd->AvailableForStates(G4State_PreInit);
+
+  fSetGdmlCacheDirCmd = new G4UIcmdWithAString("/det/gdml/cacheDir", this);
+  fSetGdmlCacheDirCmd->SetGuidance(
+      "Cache the world as GDML in this directory and read it back on the");
+  fSetGdmlCacheDirCmd->SetGuidance(
+      "next start with the same geometry and materials. The key covers the");
+  fSetGdmlCacheDirCmd->SetGuidance(
+      "parameters, the materials and the content of the geometry source");
+  fSetGdmlCacheDirCmd->SetGuidance(
+      "files listed in CMakeLists.txt.");
+  fSetGdmlCacheDirCmd->SetParameterName("dir", false);
+  fSetGdmlCacheDirCmd->AvailableForStates(G4State_PreInit);
+
+  fFastSimEnableCmd = new G4UIcmdWithABool("/det/fastsim/enable", this);
+  fFastSimEnableCmd->SetGuidance(
+      "Simulate photons in the collimator with attenuation tables.");
+  fFastSimEnableCmd->SetGuidance(
+      "Scattering in the collimator is treated as absorption, compare the");
+  fFastSimEnableCmd->SetGuidance(
+      "transmitted spectra of runs with and without it using g4fastcheck.");
+  fFastSimEnableCmd->SetParameterName("enable", false);
+  fFastSimEnableCmd->AvailableForStates(G4State_PreInit);
+
+  fFastSimMaxEnergyCmd =
+      new G4UIcmdWithADoubleAndUnit("/det/fastsim/maxEnergy", this);
+  fFastSimMaxEnergyCmd->SetGuidance(
+      "Photons above this energy are always tracked normally.");
+  fFastSimMaxEnergyCmd->SetParameterName("energy", false);
+  fFastSimMaxEnergyCmd->SetUnitCategory("Energy");
+  fFastSimMaxEnergyCmd->SetRange("energy>0.0");
+  fFastSimMaxEnergyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fPhaseSpaceZCmd = new G4UIcmdWithADoubleAndUnit("/det/phsp/z", this);
+  fPhaseSpaceZCmd->SetGuidance(
+      "Place a phase space plane at this z, particles entering it are");
+  fPhaseSpaceZCmd->SetGuidance("written to the phsp tree. The plane must lie");
+  fPhaseSpaceZCmd->SetGuidance("between the tungsten plate and the detector.");
+  fPhaseSpaceZCmd->SetParameterName("z", false);
+  fPhaseSpaceZCmd->SetUnitCategory("Length");
+  fPhaseSpaceZCmd->AvailableForStates(G4State_PreInit);
+
+  fImportanceLayersCmd =
+      new G4UIcmdWithAnInteger("/det/importance/layers", this);
+  fImportanceLayersCmd->SetGuidance(
+      "Split the plate into importance cells for photon splitting and");
+  fImportanceLayersCmd->SetGuidance("Russian roulette, 0 disables it.");
+  fImportanceLayersCmd->SetGuidance(
+      "The pixel outputs have one entry per split copy of a history.");
+  fImportanceLayersCmd->SetParameterName("layers", false);
+  fImportanceLayersCmd->SetRange("layers>=0");
+  fImportanceLayersCmd->AvailableForStates(G4State_PreInit);
+
+  fImportanceRatioCmd = new G4UIcmdWithADouble("/det/importance/ratio", this);
+  fImportanceRatioCmd->SetGuidance(
+      "Importance ratio of neighbouring layers, the number of copies of a");
+  fImportanceRatioCmd->SetGuidance("photon moving one layer deeper.");
+  fImportanceRatioCmd->SetParameterName("ratio", false);
+  fImportanceRatioCmd->SetRange("ratio>=1");
+  fImportanceRatioCmd->AvailableForStates(G4State_PreInit);
 }
 
 DetectorMessenger::~DetectorMessenger() {
+  delete fSetPlateDepthCmd;
+  delete fSetSlitPitchCmd;
+  delete fSetSlitWidthCmd;
+  delete fSetGdmlCacheDirCmd;
+  delete fFastSimEnableCmd;
+  delete fFastSimMaxEnergyCmd;
+  delete fPhaseSpaceZCmd;
+  delete fImportanceLayersCmd;
+  delete fImportanceRatioCmd;
+  delete fDetectorDir;
 }
 
 void DetectorMessenger::SetNewValue(G4UIcommand *command, G4String newValue) {
+  if (command == fSetPlateDepthCmd) {
+    fDetector->SetPlateDepth(fSetPlateDepthCmd->GetNewDoubleValue(newValue));
+  }
+  if (command == fSetSlitPitchCmd) {
+    fDetector->SetSlitPitch(fSetSlitPitchCmd->GetNewDoubleValue(newValue));
+  }
+  if (command == fSetSlitWidthCmd) {
+    fDetector->SetSlitWidth(fSetSlitWidthCmd->GetNewDoubleValue(newValue));
+  }
+  if (command == fSetGdmlCacheDirCmd) {
+    fDetector->SetGdmlCacheDir(newValue);
+  }
+  if (command == fFastSimEnableCmd) {
+    fDetector->SetFastSimEnabled(fFastSimEnableCmd->GetNewBoolValue(newValue));
+  }
+  if (command == fImportanceLayersCmd) {
+    fDetector->SetImportanceLayers(
+        fImportanceLayersCmd->GetNewIntValue(newValue));
+  }
+  if (command == fImportanceRatioCmd) {
+    fDetector->SetImportanceRatio(
+        fImportanceRatioCmd->GetNewDoubleValue(newValue));
+  }
+  if (command == fPhaseSpaceZCmd) {
+    fDetector->SetPhaseSpacePlaneZ(fPhaseSpaceZCmd->GetNewDoubleValue(newValue));
+  }
+  if (command == fFastSimMaxEnergyCmd) {
+    fDetector->SetFastSimMaxEnergy(
+        fFastSimMaxEnergyCmd->GetNewDoubleValue(newValue));
+  }
 }
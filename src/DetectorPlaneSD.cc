@@ -0,0 +1,22 @@
+/***************************************************************
+ * Absorbing detector plane
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "DetectorPlaneSD.hh"
+
+#include "AnalysisManager.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+
+DetectorPlaneSD::DetectorPlaneSD(const G4String &name)
+    : G4VSensitiveDetector(name) {}
+
+DetectorPlaneSD::~DetectorPlaneSD() {}
+
+G4bool DetectorPlaneSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
+  // the first step in the volume starts at the surface of the plane
+  AnalysisManager::GetInstance()->ProcessDetectorPlaneHit(aStep);
+  return true;
+}
@@ -0,0 +1,130 @@
+/***************************************************************
+ * Charge collection and digitization of the CdTe pixels
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "DetectorResponse.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "TRandom.h"
+
+namespace {
+const double PAIR_CREATION_ENERGY = 4.46e-3; // in units of keV
+const double CdTe_THICKNESS = 1;             // mm
+
+// splitmix64 finalizer, maps a counter to a well mixed 64-bit key
+unsigned long long MixSeed(unsigned long long x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+} // namespace
+
+DetectorResponse::DetectorResponse() {
+  // CdTe fano factor is 0.15 according to
+  // https://www.researchgate.net/figure/Fano-factor-for-different-semiconductor-at-room-temperature_tbl5_343053397
+  // On Jun 27, the enoise and fano factor were found to be .24 and 0.74
+  // through fitting of Ba133 exp sim spectrum, see:
+  // ~/FHNW/STIX/SolarFlareAnalysis/fitG4CalibrationSpectrum
+  fFanoFactor = 0.15; // from best fit
+  // 0.52 is from the best fit, from gussian fit, it should be 1.2/2.35=0.5
+  fNoise = 0.43;
+  /* At 30 keV, the energy resolution is 2%  * 30 keV= 0.6 keV
+   * using fano factor, one could know the intrinsic resolution of CdTe is
+   * rho=(pairs * 0.15)/pairs =0.0047 absolute resolution is rho*30 = 0.14
+   * keV ADC resolution is 0.5 ADC channel,this is equivalent  to 0.5 /2.3
+   * =0.2 keV for calibration spectrum electronics noise = sqrt(0.6*0.6
+   * -0.14*0.14 - 0.2*0.2)
+   */
+  fThreshold = 4;
+  // see Oliver's paper, mean values, best FIT L=5.28e-3, R0=0.1, set
+  // enoise=0.52, fano=0.15
+  fNearSurfaceR0 = 0.116;
+  fNearSurfaceL = 5.28e-3;
+  fHighVoltage = 300; // CdTe HV is 300 during the nominal operations
+}
+
+bool DetectorResponse::SetParameter(const std::string &name, double value) {
+  if (name == "fano") {
+    fFanoFactor = value;
+  } else if (name == "enoise") {
+    fNoise = value;
+  } else if (name == "threshold") {
+    fThreshold = value;
+  } else if (name == "r0") {
+    fNearSurfaceR0 = value;
+  } else if (name == "l") {
+    fNearSurfaceL = value;
+  } else if (name == "hv") {
+    fHighVoltage = value;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool DetectorResponse::SetParameter(const std::string &nameEqualsValue) {
+  size_t eq = nameEqualsValue.find('=');
+  if (eq == std::string::npos || eq + 1 >= nameEqualsValue.size())
+    return false;
+  char *end = NULL;
+  double value = strtod(nameEqualsValue.c_str() + eq + 1, &end);
+  if (*end != '\0')
+    return false;
+  return SetParameter(nameEqualsValue.substr(0, eq), value);
+}
+
+std::string DetectorResponse::Describe() const {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "fano=%g enoise=%g threshold=%g r0=%g l=%g hv=%g", fFanoFactor,
+           fNoise, fThreshold, fNearSurfaceR0, fNearSurfaceL, fHighVoltage);
+  return buf;
+}
+
+double DetectorResponse::GetCollectionEfficiency(double depth) const {
+  // Hecht equation, see "Recent Progress in CdTe and CdZnTe Detectors"
+  // Tadayuki Takahashi and Shin Watanabe
+  // Oliver's paper
+  // Spectral signature of near-surface damage in CdTe X-ray detectors
+  double freePathElectron = 1100 * 100 * 3e-6 * fHighVoltage;
+  double freePathHoles = 100 * 100 * 2e-6 * fHighVoltage;
+  double d = CdTe_THICKNESS;
+  return (1 - exp((depth - d) / freePathElectron)) * (freePathElectron / d) +
+         (freePathHoles / d) * (1.0 - exp(-depth / freePathHoles));
+}
+
+double DetectorResponse::GetNearSurfaceFactor(double depth) const {
+  return 1 - fNearSurfaceR0 * exp(-depth / fNearSurfaceL);
+}
+
+double DetectorResponse::GetEnergyResolution(double energy) const {
+  // sigma^2 = fano * n, n = E / w, equivalent to delta_E = 2.35
+  // sqrt(F w E), see
+  // https://www.sciencedirect.com/topics/neuroscience/fano-factor
+  return sqrt(fFanoFactor * PAIR_CREATION_ENERGY * energy);
+}
+
+void DetectorResponse::Digitize(double collected, TRandom *random,
+                                double &charge, double &charge2) const {
+  charge = random->Gaus(collected, GetEnergyResolution(collected));
+  charge2 = random->Gaus(charge, fNoise);
+}
+
+unsigned long long DetectorResponse::GetEventKey(long long runSeed,
+                                                 long long eventID) {
+  return MixSeed(MixSeed((unsigned long long)runSeed) ^
+                 (unsigned long long)eventID);
+}
+
+unsigned long DetectorResponse::GetDigitizationSeed(long long runSeed,
+                                                    long long eventID) {
+  // an independent stream for the digitization
+  unsigned long long key = MixSeed(GetEventKey(runSeed, eventID));
+  return (unsigned long)((key & 0xffffffff) | 1);
+}
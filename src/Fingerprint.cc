@@ -0,0 +1,40 @@
+/***************************************************************
+ * Content hashes used to key the geometry and physics caches
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "Fingerprint.hh"
+
+#include <iomanip>
+#include <sstream>
+
+#include "G4Element.hh"
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+
+G4String HashToHex(const std::string &text) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < text.size(); i++) {
+    hash ^= (unsigned char)text[i];
+    hash *= 1099511628211ULL;
+  }
+  std::ostringstream hex;
+  hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return hex.str();
+}
+
+void DescribeMaterials(std::ostream &os) {
+  std::streamsize precision = os.precision(17);
+  const G4MaterialTable *materials = G4Material::GetMaterialTable();
+  for (size_t i = 0; i < materials->size(); i++) {
+    const G4Material *mat = (*materials)[i];
+    os << mat->GetName() << " " << mat->GetDensity() / (g / cm3);
+    const G4double *fractions = mat->GetFractionVector();
+    for (size_t j = 0; j < mat->GetNumberOfElements(); j++) {
+      os << " " << mat->GetElement(j)->GetName() << " " << fractions[j];
+    }
+    os << "\n";
+  }
+  os.precision(precision);
+}
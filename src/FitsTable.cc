@@ -0,0 +1,253 @@
+/***************************************************************
+ * Minimal writer of FITS binary tables
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * See the FITS standard 4.0, sections 4 (headers) and 7.3 (binary
+ * tables).
+ ***************************************************************/
+#include "FitsTable.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+const size_t BLOCK_SIZE = 2880;
+const size_t CARD_SIZE = 80;
+
+std::string MakeCard(const std::string &key, const std::string &value,
+                     const std::string &comment) {
+  char buf[CARD_SIZE + 1];
+  // fixed format: keyword in columns 1-8, "= " in 9-10, value from 11
+  snprintf(buf, sizeof(buf), "%-8.8s= %s", key.c_str(), value.c_str());
+  std::string card = buf;
+  if (!comment.empty())
+    card += " / " + comment;
+  card.resize(CARD_SIZE, ' ');
+  return card;
+}
+
+// right justified in columns 11-30
+std::string FixedValue(const std::string &value) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%20s", value.c_str());
+  return buf;
+}
+
+std::string QuotedValue(const std::string &value) {
+  std::string quoted = "'";
+  for (size_t i = 0; i < value.size(); i++) {
+    quoted += value[i];
+    if (value[i] == '\'')
+      quoted += '\'';
+  }
+  // strings are padded to at least 8 characters
+  while (quoted.size() < 9)
+    quoted += ' ';
+  return quoted + "'";
+}
+
+void WriteWord(std::ostream &out, unsigned int word) {
+  unsigned char bytes[4] = {
+      (unsigned char)(word >> 24), (unsigned char)(word >> 16),
+      (unsigned char)(word >> 8), (unsigned char)word};
+  out.write((const char *)bytes, 4);
+}
+
+void WriteHeader(std::ostream &out, const std::vector<std::string> &cards) {
+  size_t size = 0;
+  for (size_t i = 0; i < cards.size(); i++) {
+    out << cards[i];
+    size += CARD_SIZE;
+  }
+  std::string end = "END";
+  end.resize(CARD_SIZE, ' ');
+  out << end;
+  size += CARD_SIZE;
+  out << std::string((BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE, ' ');
+}
+
+void PadData(std::ostream &out, size_t size) {
+  out << std::string((BLOCK_SIZE - size % BLOCK_SIZE) % BLOCK_SIZE, '\0');
+}
+
+unsigned int FloatWord(float value) {
+  unsigned int word;
+  memcpy(&word, &value, 4);
+  return word;
+}
+} // namespace
+
+FitsTable::FitsTable(const std::string &extname, size_t numRows)
+    : fExtname(extname), fNumRows(numRows) {}
+
+void FitsTable::AddKey(const std::string &key, const std::string &value,
+                       const std::string &comment) {
+  fKeys.push_back(MakeCard(key, QuotedValue(value), comment));
+}
+
+void FitsTable::AddKey(const std::string &key, long value,
+                       const std::string &comment) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%ld", value);
+  fKeys.push_back(MakeCard(key, FixedValue(buf), comment));
+}
+
+void FitsTable::AddKey(const std::string &key, double value,
+                       const std::string &comment) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.10E", value);
+  fKeys.push_back(MakeCard(key, FixedValue(buf), comment));
+}
+
+void FitsTable::AddLogicalKey(const std::string &key, bool value,
+                              const std::string &comment) {
+  fKeys.push_back(MakeCard(key, FixedValue(value ? "T" : "F"), comment));
+}
+
+void FitsTable::AddColumn(
+    const std::string &name, const std::string &unit, char type, bool variable,
+    const std::vector<std::vector<unsigned int> > &data) {
+  if (data.size() != fNumRows) {
+    std::cerr << "Column " << name << " of " << fExtname << " has "
+              << data.size() << " rows instead of " << fNumRows << std::endl;
+  }
+  Column column;
+  column.name = name;
+  column.unit = unit;
+  column.type = type;
+  column.variable = variable;
+  column.data = data;
+  column.data.resize(fNumRows);
+  fColumns.push_back(column);
+}
+
+void FitsTable::AddColumn(const std::string &name, const std::string &unit,
+                          const std::vector<int> &values) {
+  std::vector<std::vector<unsigned int> > data(values.size());
+  for (size_t i = 0; i < values.size(); i++)
+    data[i].push_back((unsigned int)values[i]);
+  AddColumn(name, unit, 'J', false, data);
+}
+
+void FitsTable::AddColumn(const std::string &name, const std::string &unit,
+                          const std::vector<float> &values) {
+  std::vector<std::vector<unsigned int> > data(values.size());
+  for (size_t i = 0; i < values.size(); i++)
+    data[i].push_back(FloatWord(values[i]));
+  AddColumn(name, unit, 'E', false, data);
+}
+
+void FitsTable::AddColumn(const std::string &name, const std::string &unit,
+                          const std::vector<std::vector<int> > &values) {
+  std::vector<std::vector<unsigned int> > data(values.size());
+  for (size_t i = 0; i < values.size(); i++)
+    data[i].assign(values[i].begin(), values[i].end());
+  AddColumn(name, unit, 'J', true, data);
+}
+
+void FitsTable::AddColumn(const std::string &name, const std::string &unit,
+                          const std::vector<std::vector<float> > &values) {
+  std::vector<std::vector<unsigned int> > data(values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    for (size_t j = 0; j < values[i].size(); j++)
+      data[i].push_back(FloatWord(values[i][j]));
+  }
+  AddColumn(name, unit, 'E', true, data);
+}
+
+void FitsTable::Write(std::ostream &out) const {
+  size_t rowSize = 0;
+  size_t heapSize = 0;
+  for (size_t c = 0; c < fColumns.size(); c++) {
+    rowSize += fColumns[c].variable ? 8 : 4;
+    if (!fColumns[c].variable)
+      continue;
+    for (size_t r = 0; r < fNumRows; r++)
+      heapSize += 4 * fColumns[c].data[r].size();
+  }
+
+  std::vector<std::string> cards;
+  cards.push_back(MakeCard("XTENSION", QuotedValue("BINTABLE"),
+                           "binary table extension"));
+  cards.push_back(MakeCard("BITPIX", FixedValue("8"), ""));
+  cards.push_back(MakeCard("NAXIS", FixedValue("2"), ""));
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%lu", (unsigned long)rowSize);
+  cards.push_back(MakeCard("NAXIS1", FixedValue(buf), "bytes per row"));
+  snprintf(buf, sizeof(buf), "%lu", (unsigned long)fNumRows);
+  cards.push_back(MakeCard("NAXIS2", FixedValue(buf), "number of rows"));
+  snprintf(buf, sizeof(buf), "%lu", (unsigned long)heapSize);
+  cards.push_back(MakeCard("PCOUNT", FixedValue(buf), "heap size"));
+  cards.push_back(MakeCard("GCOUNT", FixedValue("1"), ""));
+  snprintf(buf, sizeof(buf), "%lu", (unsigned long)fColumns.size());
+  cards.push_back(MakeCard("TFIELDS", FixedValue(buf), ""));
+  for (size_t c = 0; c < fColumns.size(); c++) {
+    const Column &column = fColumns[c];
+    std::string n = std::to_string(c + 1);
+    std::string form(1, column.type);
+    if (column.variable) {
+      size_t maxLength = 0;
+      for (size_t r = 0; r < fNumRows; r++)
+        maxLength = std::max(maxLength, column.data[r].size());
+      form = "1P" + form + "(" + std::to_string(maxLength) + ")";
+    } else {
+      form = "1" + form;
+    }
+    cards.push_back(MakeCard("TTYPE" + n, QuotedValue(column.name), ""));
+    cards.push_back(MakeCard("TFORM" + n, QuotedValue(form), ""));
+    if (!column.unit.empty())
+      cards.push_back(MakeCard("TUNIT" + n, QuotedValue(column.unit), ""));
+  }
+  cards.push_back(MakeCard("EXTNAME", QuotedValue(fExtname), ""));
+  cards.insert(cards.end(), fKeys.begin(), fKeys.end());
+  WriteHeader(out, cards);
+
+  size_t heapOffset = 0;
+  for (size_t r = 0; r < fNumRows; r++) {
+    for (size_t c = 0; c < fColumns.size(); c++) {
+      const std::vector<unsigned int> &values = fColumns[c].data[r];
+      if (fColumns[c].variable) {
+        // descriptor: number of elements and byte offset in the heap
+        WriteWord(out, values.size());
+        WriteWord(out, heapOffset);
+        heapOffset += 4 * values.size();
+      } else {
+        WriteWord(out, values.empty() ? 0 : values[0]);
+      }
+    }
+  }
+  // the heap follows the table in the same order as the descriptors
+  for (size_t r = 0; r < fNumRows; r++) {
+    for (size_t c = 0; c < fColumns.size(); c++) {
+      if (!fColumns[c].variable)
+        continue;
+      const std::vector<unsigned int> &values = fColumns[c].data[r];
+      for (size_t i = 0; i < values.size(); i++)
+        WriteWord(out, values[i]);
+    }
+  }
+  PadData(out, rowSize * fNumRows + heapSize);
+}
+
+bool FitsTable::WriteFile(const std::string &filename,
+                          const std::vector<FitsTable> &tables) {
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  if (!out.good()) {
+    std::cerr << "Can not create " << filename << std::endl;
+    return false;
+  }
+  std::vector<std::string> cards;
+  cards.push_back(MakeCard("SIMPLE", FixedValue("T"), "FITS standard"));
+  cards.push_back(MakeCard("BITPIX", FixedValue("8"), ""));
+  cards.push_back(MakeCard("NAXIS", FixedValue("0"), "no primary data"));
+  cards.push_back(MakeCard("EXTEND", FixedValue("T"), ""));
+  WriteHeader(out, cards);
+  for (size_t i = 0; i < tables.size(); i++)
+    tables[i].Write(out);
+  return out.good();
+}
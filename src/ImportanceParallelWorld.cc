@@ -0,0 +1,84 @@
+/***************************************************************
+ * Importance cells for geometric biasing of photons
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "ImportanceParallelWorld.hh"
+
+#include <cmath>
+
+#include "DetectorConstruction.hh"
+#include "G4Box.hh"
+#include "G4IStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "G4VPhysicalVolume.hh"
+
+ImportanceParallelWorld::ImportanceParallelWorld(
+    const G4String &worldName, DetectorConstruction *detector)
+    : G4VUserParallelWorld(worldName), fDetector(detector) {}
+
+ImportanceParallelWorld::~ImportanceParallelWorld() {}
+
+void ImportanceParallelWorld::Construct() {
+  G4VPhysicalVolume *ghostWorld = GetWorld();
+  G4LogicalVolume *ghostLogical = ghostWorld->GetLogicalVolume();
+  fCells.clear();
+  fImportances.clear();
+  // the mother covers the front of the plate
+  fCells.push_back(ghostWorld);
+  fImportances.push_back(1);
+
+  G4int numLayers = fDetector->GetImportanceLayers();
+  if (numLayers <= 0)
+    return;
+  G4double ratio = fDetector->GetImportanceRatio();
+  G4Box *worldBox = dynamic_cast<G4Box *>(ghostLogical->GetSolid());
+  G4double halfX = worldBox->GetXHalfLength();
+  G4double halfY = worldBox->GetYHalfLength();
+  G4double halfZ = worldBox->GetZHalfLength();
+  G4double plateHalfDepth = fDetector->GetPlateHalfDepth();
+  G4double layerHalfDepth = plateHalfDepth / numLayers;
+
+  // no material, the cells only exist for the importance store
+  G4Box *layerBox =
+      new G4Box("importanceLayer", halfX, halfY, layerHalfDepth);
+  G4LogicalVolume *layerLogical =
+      new G4LogicalVolume(layerBox, 0, "importanceLayer", 0, 0, 0);
+  G4double importance = 1;
+  for (G4int i = 0; i < numLayers; i++) {
+    importance *= ratio;
+    G4double z = -plateHalfDepth + (2 * i + 1) * layerHalfDepth;
+    fCells.push_back(new G4PVPlacement(0, G4ThreeVector(0, 0, z),
+                                       layerLogical, "importanceLayer",
+                                       ghostLogical, false, i, false));
+    fImportances.push_back(importance);
+  }
+
+  G4double backHalfDepth = 0.5 * (halfZ - plateHalfDepth);
+  G4Box *backBox = new G4Box("importanceBack", halfX, halfY, backHalfDepth);
+  G4LogicalVolume *backLogical =
+      new G4LogicalVolume(backBox, 0, "importanceBack", 0, 0, 0);
+  fCells.push_back(new G4PVPlacement(
+      0, G4ThreeVector(0, 0, plateHalfDepth + backHalfDepth), backLogical,
+      "importanceBack", ghostLogical, false, 0, false));
+  fImportances.push_back(importance);
+
+  G4cout << "Importance sampling: " << numLayers
+         << " layers in the plate, importance " << ratio << "^i, up to "
+         << importance << " behind the plate" << G4endl;
+}
+
+void ImportanceParallelWorld::ConstructSD() {
+  if (fDetector->GetImportanceLayers() <= 0)
+    return;
+  G4IStore *store = G4IStore::GetInstance(GetName());
+  // copy numbers are used as replica numbers of the geometry cells
+  for (size_t i = 0; i < fCells.size(); i++) {
+    store->AddImportanceGeometryCell(fImportances[i], *fCells[i],
+                                     fCells[i]->GetCopyNo());
+  }
+}
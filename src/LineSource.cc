@@ -0,0 +1,70 @@
+/***************************************************************
+ * Radionuclide sources with tabulated emission lines
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "LineSource.hh"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+LineSource::LineSource() : fFilename(""), fMeanMultiplicity(0) {}
+
+bool LineSource::Load(const std::string &name) {
+  fFilename = name;
+  if (name.find(".dat") == std::string::npos)
+    fFilename = "data/" + name + ".dat";
+  std::ifstream infile(fFilename.c_str());
+  if (!infile.good()) {
+    std::cout << "Can not open line source " << fFilename << std::endl;
+    return false;
+  }
+  fEnergies.clear();
+  fIntensities.clear();
+  std::string line;
+  while (std::getline(infile, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream words(line);
+    double energy, intensity;
+    if (words >> energy >> intensity && intensity > 0) {
+      fEnergies.push_back(energy);
+      fIntensities.push_back(intensity);
+    }
+  }
+  if (fEnergies.empty()) {
+    std::cout << "No lines in " << fFilename << std::endl;
+    return false;
+  }
+
+  // distribution of the number of photons per decay, each line being
+  // emitted with probability intensity/100
+  int n = fEnergies.size();
+  std::vector<double> numPhotons(n + 1, 0.);
+  numPhotons[0] = 1;
+  for (int i = 0; i < n; i++) {
+    double p = fIntensities[i] / 100;
+    if (p > 1)
+      p = 1;
+    for (int k = i + 1; k > 0; k--) {
+      numPhotons[k] = numPhotons[k] * (1 - p) + numPhotons[k - 1] * p;
+    }
+    numPhotons[0] *= 1 - p;
+  }
+  std::vector<double> multiplicity(numPhotons.begin() + 1, numPhotons.end());
+  double sum = 0;
+  fMeanMultiplicity = 0;
+  for (int k = 0; k < n; k++) {
+    sum += multiplicity[k];
+    fMeanMultiplicity += (k + 1) * multiplicity[k];
+  }
+  fMeanMultiplicity /= sum;
+
+  fLines.Build(fIntensities);
+  fMultiplicity.Build(multiplicity);
+  std::cout << "Line source " << fFilename << ": " << n
+            << " lines, mean multiplicity " << fMeanMultiplicity << std::endl;
+  return true;
+}
@@ -0,0 +1,45 @@
+/***************************************************************
+ * Layout of the g4main outputs
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "OutputLayout.hh"
+
+#include "ScienceChannels.hh"
+#include "TH1F.h"
+
+namespace {
+const char *const SPECTRUM_PREFIXES[NUM_PIXEL_SPECTRA] = {
+    "hEdep", "hReal", "hEdepSci", "hRealSci"};
+const char *const SPECTRUM_TITLES[NUM_PIXEL_SPECTRA] = {
+    "Deposited energy spectrum (%s); Energy (keV)",
+    "Recorded energy spectrum (%s); Energy (keV)",
+    "Deposited energy spectrum - Rebinned to SCI channels (%s); Energy (keV)",
+    "Recorded energy spectrum - Rebinned to SCI channels (%s); Energy (keV)"};
+} // namespace
+
+bool IsScienceSpectrum(int spectrum) {
+  return spectrum == kEdepSciSpectrum || spectrum == kRealSciSpectrum;
+}
+
+TString GetPixelSpectrumName(int spectrum, int pixel) {
+  if (pixel < NUM_PIXELS)
+    return TString::Format("%sPixel%d", SPECTRUM_PREFIXES[spectrum], pixel);
+  return TString::Format("%s%d", SPECTRUM_PREFIXES[spectrum],
+                         SUMMED_SPECTRUM_SLOT);
+}
+
+TString GetPixelSpectrumTitle(int spectrum, int pixel) {
+  TString label = pixel < NUM_PIXELS ? TString::Format("pixel %d", pixel)
+                                     : TString("Detector summed");
+  return TString::Format(SPECTRUM_TITLES[spectrum], label.Data());
+}
+
+TH1F *BookPixelSpectrum(int spectrum, int pixel) {
+  TString name = GetPixelSpectrumName(spectrum, pixel);
+  TString title = GetPixelSpectrumTitle(spectrum, pixel);
+  if (IsScienceSpectrum(spectrum))
+    return new TH1F(name, title, NUM_SCIENCE_CHANNELS, SCIENCE_ENERGY_EDGES);
+  return new TH1F(name, title, SPECTRUM_NUM_BINS, 0, SPECTRUM_MAX_ENERGY);
+}
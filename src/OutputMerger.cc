@@ -0,0 +1,83 @@
+/***************************************************************
+ * Merging of g4main output files
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "OutputMerger.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "TFile.h"
+#include "TFileMerger.h"
+#include "TNamed.h"
+
+namespace {
+// seed and offset lines of the metadata, kept for every input
+TString GetShardSummary(const TString &title) {
+  TString summary;
+  std::istringstream lines(title.Data());
+  std::string line;
+  while (std::getline(lines, line)) {
+    TString l(line.c_str());
+    if (l.Contains("Command:") || l.Contains("Random seed:") ||
+        l.Contains("Event ID offset:")) {
+      summary += TString(l.Strip(TString::kBoth)) + "\n";
+    }
+  }
+  return summary;
+}
+} // namespace
+
+bool MergeOutputFiles(const std::vector<TString> &inputs,
+                      const TString &output) {
+  if (inputs.empty()) {
+    std::cout << "No files to merge into " << output << std::endl;
+    return false;
+  }
+  TFileMerger merger(kFALSE, kFALSE);
+  merger.SetPrintLevel(0);
+  if (!merger.OutputFile(output.Data(), "RECREATE")) {
+    std::cout << "Can not create " << output << std::endl;
+    return false;
+  }
+  TString mergedMetadata;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (!merger.AddFile(inputs[i].Data(), kFALSE)) {
+      std::cout << "Can not open " << inputs[i] << std::endl;
+      return false;
+    }
+    // the metadata is a TNamed, which can not be merged by TFileMerger
+    TFile *f = TFile::Open(inputs[i].Data());
+    TNamed *meta = f ? (TNamed *)f->Get("metadata") : NULL;
+    if (meta) {
+      if (mergedMetadata == "") {
+        mergedMetadata = meta->GetTitle();
+        mergedMetadata += "\n---------------  Merged files---------------\n";
+      }
+      mergedMetadata += Form("%s:\n", inputs[i].Data());
+      mergedMetadata += GetShardSummary(meta->GetTitle());
+    }
+    delete f;
+  }
+  merger.AddObjectNames("metadata c1");
+  Int_t mode =
+      TFileMerger::kAll | TFileMerger::kRegular | TFileMerger::kSkipListed;
+  if (!merger.PartialMerge(mode)) {
+    std::cout << "Failed to merge files into " << output << std::endl;
+    return false;
+  }
+  if (mergedMetadata != "") {
+    TFile f(output.Data(), "update");
+    TNamed cmd;
+    cmd.SetTitle(mergedMetadata);
+    f.cd();
+    cmd.Write("metadata");
+    f.Close();
+  }
+  std::cout << "Merged " << inputs.size() << " files into " << output
+            << std::endl;
+  return true;
+}
@@ -0,0 +1,23 @@
+/***************************************************************
+ * Phase space scoring plane
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "PhaseSpaceSD.hh"
+
+#include "AnalysisManager.hh"
+#include "G4Step.hh"
+
+PhaseSpaceSD::PhaseSpaceSD(const G4String &name) : G4VSensitiveDetector(name) {}
+
+PhaseSpaceSD::~PhaseSpaceSD() {}
+
+G4bool PhaseSpaceSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
+  // only the step entering the plane, a particle crossing it makes one
+  // record
+  if (aStep->GetPreStepPoint()->GetStepStatus() != fGeomBoundary)
+    return false;
+  AnalysisManager::GetInstance()->FillPhaseSpace(aStep);
+  return true;
+}
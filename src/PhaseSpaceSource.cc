@@ -0,0 +1,137 @@
+/***************************************************************
+ * Replay of phase space files
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "PhaseSpaceSource.hh"
+
+#include <sstream>
+#include <string>
+
+#include "G4Event.hh"
+#include "G4ParticleGun.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TObjArray.h"
+
+namespace {
+void AddFiles(TChain *chain, const G4String &files) {
+  std::istringstream patterns(files);
+  std::string pattern;
+  while (std::getline(patterns, pattern, ',')) {
+    if (pattern != "")
+      chain->Add(pattern.c_str());
+  }
+}
+} // namespace
+
+PhaseSpaceSource::PhaseSpaceSource(const G4String &files,
+                                   const std::vector<Long64_t> *historyStart,
+                                   G4int numUses, G4bool rotate)
+    : fFiles(files), fNumUses(numUses > 0 ? numUses : 1), fRotate(rotate),
+      fChain(NULL), fHistoryStart(historyStart) {}
+
+PhaseSpaceSource::~PhaseSpaceSource() { delete fChain; }
+
+Long64_t PhaseSpaceSource::CountFirstStageEvents(const G4String &files) {
+  TChain chain("phsp");
+  AddFiles(&chain, files);
+  TObjArray *list = chain.GetListOfFiles();
+  Long64_t numEvents = 0;
+  for (int i = 0; i < list->GetEntries(); i++) {
+    TFile f(list->At(i)->GetTitle());
+    TH1 *h = f.IsZombie() ? NULL : (TH1 *)f.Get("hist/hNumEvents");
+    if (!h)
+      return -1;
+    numEvents += (Long64_t)h->GetBinContent(1);
+  }
+  return numEvents;
+}
+
+G4bool PhaseSpaceSource::BuildHistoryIndex(
+    const G4String &files, std::vector<Long64_t> &historyStart) {
+  TChain chain("phsp");
+  AddFiles(&chain, files);
+  Long64_t numEntries = chain.GetEntries();
+  historyStart.clear();
+  if (numEntries <= 0)
+    return false;
+  // the records of an event are consecutive, a history starts where the
+  // event ID or the file changes
+  Long64_t eventID = -1, lastEventID = -1;
+  Int_t lastTree = -1;
+  chain.SetBranchStatus("*", false);
+  chain.SetBranchStatus("eventID", true);
+  chain.SetBranchAddress("eventID", &eventID);
+  for (Long64_t i = 0; i < numEntries; i++) {
+    chain.GetEntry(i);
+    if (i == 0 || eventID != lastEventID || chain.GetTreeNumber() != lastTree)
+      historyStart.push_back(i);
+    lastEventID = eventID;
+    lastTree = chain.GetTreeNumber();
+  }
+  historyStart.push_back(numEntries);
+  return true;
+}
+
+G4bool PhaseSpaceSource::Open() {
+  fChain = new TChain("phsp");
+  AddFiles(fChain, fFiles);
+  // the index must describe these files
+  if (!fHistoryStart || fHistoryStart->size() < 2 ||
+      fChain->GetEntries() != fHistoryStart->back())
+    return false;
+  fChain->SetBranchAddress("pdg", &fPDG);
+  fChain->SetBranchAddress("energy", &fEnergy);
+  fChain->SetBranchAddress("pos", fPos);
+  fChain->SetBranchAddress("dir", fDir);
+  fChain->SetBranchAddress("weight", &fWeight);
+  fChain->SetCacheSize(64 * 1024 * 1024);
+  fChain->AddBranchToCache("*", kTRUE);
+  fChain->StopCacheLearningPhase();
+  return true;
+}
+
+G4bool PhaseSpaceSource::GeneratePrimary(G4ParticleGun *gun, G4Event *event,
+                                         Long64_t globalEventID) {
+  if (!fChain && !Open()) {
+    G4Exception("PhaseSpaceSource::GeneratePrimary()", "Gen003",
+                FatalException, ("Can not read " + fFiles).c_str());
+  }
+  // the uses of a history are consecutive events, so the reading stays
+  // sequential for the tree cache
+  size_t history = globalEventID / fNumUses;
+  if (history + 1 >= fHistoryStart->size())
+    return false;
+  G4double phi = fRotate ? twopi * G4UniformRand() : 0;
+  for (Long64_t entry = (*fHistoryStart)[history];
+       entry < (*fHistoryStart)[history + 1]; entry++) {
+    fChain->GetEntry(entry);
+    G4ParticleDefinition *particle =
+        G4ParticleTable::GetParticleTable()->FindParticle(fPDG);
+    if (!particle) {
+      G4cout << "Phase space: unknown PDG code " << fPDG << " in entry "
+             << entry << G4endl;
+      continue;
+    }
+    G4ThreeVector pos(fPos[0] * mm, fPos[1] * mm, fPos[2] * mm);
+    G4ThreeVector dir(fDir[0], fDir[1], fDir[2]);
+    pos.rotateZ(phi);
+    dir.rotateZ(phi);
+    gun->SetParticleDefinition(particle);
+    gun->SetParticleEnergy(fEnergy * keV);
+    gun->SetParticlePosition(pos);
+    gun->SetParticleMomentumDirection(dir);
+    gun->GeneratePrimaryVertex(event);
+    event->GetPrimaryVertex(event->GetNumberOfPrimaryVertex() - 1)
+        ->SetWeight(fWeight / fNumUses);
+  }
+  return true;
+}
@@ -0,0 +1,46 @@
+/***************************************************************
+ * CdTe pixels
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "PixelSD.hh"
+
+#include "AnalysisManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TouchableHistory.hh"
+#include "G4VTouchable.hh"
+
+PixelSD::PixelSD(const G4String &name, G4double thickness)
+    : G4VSensitiveDetector(name), fThickness(thickness) {}
+
+PixelSD::~PixelSD() {}
+
+G4bool PixelSD::ProcessHits(G4Step *aStep, G4TouchableHistory *) {
+  G4double edep = aStep->GetTotalEnergyDeposit();
+  if (edep <= 0)
+    return false;
+
+  G4StepPoint *preStep = aStep->GetPreStepPoint();
+  const G4VTouchable *touchable = preStep->GetTouchable();
+  G4int channel = touchable->GetCopyNumber();
+
+  // charge is created at the post step point, depth is from the cathode
+  G4ThreeVector localPos =
+      touchable->GetHistory()->GetTopTransform().TransformPoint(
+          aStep->GetPostStepPoint()->GetPosition());
+  G4double depth = (fThickness / 2 - localPos.z()) / mm;
+
+  // not 1 with biased sources, splitting or Russian roulette
+  G4double weight = preStep->GetWeight();
+  AnalysisManager *analysisManager = AnalysisManager::GetInstance();
+  G4double eff = analysisManager->ComputeCollectionEfficiency(depth, weight) *
+                 analysisManager->GetNearSurfaceFactor(depth, weight);
+  analysisManager->AddEnergy(channel, edep / keV, weight);
+  analysisManager->AddCollectedEnergy(channel, eff * edep / keV);
+  analysisManager->RecordHit(channel, depth, edep / keV,
+                             aStep->GetPostStepPoint()->GetGlobalTime() / ns,
+                             weight);
+  return true;
+}
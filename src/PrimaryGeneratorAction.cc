@@ -7,6 +7,13 @@
 
 #include "PrimaryGeneratorAction.hh"
 
+#include "AnalysisManager.hh"
+#include "ApertureSampler.hh"
+#include "LineSource.hh"
+#include "PhaseSpaceSource.hh"
+#include "RayTracer.hh"
+#include "SpectrumSampler.hh"
+#include "TChain.h"
 #include "TFile.h"
 #include "TH1F.h"
 #include "TTree.h"
@@ -15,53 +22,25 @@
 #include <CLHEP/Random/RandFlat.h>
 
 #include <fstream>
+#include <sstream>
 
 #include "G4Event.hh"
 #include "G4GeneralParticleSource.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
+#include "G4RunManager.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4RandomDirection.hh"
+#include "G4SPSPosDistribution.hh"
+#include "G4SingleParticleSource.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4UImanager.hh"
 #include "Randomize.hh"
-// Ba133  energies
-#define NUM_GAMMAS 29
-
-// ba133 emission lines
-// taken from decay.exe
-const G4double prob[NUM_GAMMAS] = {8.94,  62.05, 18.33,
-
-                                   7.164, 0.45,
-
-                                   0.645, 34.06,
-
-                                   2.62,  2.199,
-
-                                   0.74,  3.58,  0.123, 11.6, 5.99,
-
-                                   64.5,  34.9,  0.004, 0.22, 0.15,
-                                   0.54,  1.19,  0.048, 0.93, 0.56,
-                                   3.8,   6,     0.66,  0.11, 0.24};
-const G4double gammaEnergy[NUM_GAMMAS] = {383.85, 356.02, 302.85,
-
-                                          276.4,  223.23,
-
-                                          160.61, 81,
-
-                                          79.61,  53.16,
-
-                                          35.907, 35.818, 35.252, 34.987, 34.92,
-
-                                          30.973, 30.625, 30.27,
-
-                                          5.553,  5.542,  5.281,  4.934,  4.781,
-                                          4.717,  4.649,  4.62,   4.286,  4.272,
-                                          4.142,  3.795};
-
 PrimaryGeneratorAction::PrimaryGeneratorAction()
     : sourceType(0), fTree(NULL), fFile(NULL), nEntries(0), iEntry(0) {
   // fParticleGunMessenger = new PrimaryGeneratorMessenger(this);
-  fHistoEnergy = NULL;
 
   // particle source
   particleSource = "";
@@ -80,60 +59,74 @@ PrimaryGeneratorAction::PrimaryGeneratorAction()
   // particle source
   fParticleSource = new G4GeneralParticleSource();
   // fParticleSource->SetParticleEnergy(50*keV);
-  histoEnergy = NULL;
+  fSpectrum = NULL;
+  numRays = 0;
+  fRayTracer = NULL;
+  fLineSource = NULL;
+  fPhaseSpace = NULL;
+  apertureBias = 0;
+  fAperture = NULL;
+  inputFilename = "";
+  ts = NULL;
 }
 PrimaryGeneratorAction::~PrimaryGeneratorAction() {
   delete fParticleSource;
   // delete fParticleGunMessenger;
   delete fParticleGun;
-  if (fHistoEnergy)
-    fHistoEnergy->Close();
+  delete fRayTracer;
+  delete fLineSource;
+  delete fPhaseSpace;
+  delete fAperture;
+  // the chain owns its current file, t2sim only reads it
+  delete ts;
+  delete fTree;
 }
 
-void PrimaryGeneratorAction::InitParticleSpectrumFromROOT(G4String val) {
-  // don't use this method, use /gps/hist/file instead June 7, 2023
-  // because using gps with setparticleenergy doesn't work
-  /*
-     particleSourceFile=val;
-     particleSource="fromROOT";
-     G4cout<<"Read spectrum file ROOT:"<<particleSourceFile<<G4endl;
-  //file generated in the folder:
-  /home/xiaohl/FHNW/STIX/SolarFlareAnalysis/response_matrix fHistoEnergy=new
-  TFile(val.data()); histoEnergy=(TH1F*)fHistoEnergy->Get("hspec");
-  if(!histoEnergy){
-  G4cout<<"Can not read hspec from ROOT file"<<G4endl;
+void PrimaryGeneratorAction::SetParticleSource(G4String val) {
+  // any source other than the GPS and fromTree is a radionuclide with its
+  // lines in data/
+  particleSource = val;
+  delete fLineSource;
+  fLineSource = NULL;
+  if (val == "" || val == "fromTree" || val == "fromPhaseSpace")
+    return;
+  fLineSource = new LineSource();
+  if (!fLineSource->Load(val)) {
+    G4Exception("PrimaryGeneratorAction::SetParticleSource()", "Gen001",
+                FatalException, ("Can not load the line source " + val).c_str());
   }
+}
 
-*/
+void PrimaryGeneratorAction::SetInputFile(G4String val) {
+  // the chain is opened by the first event of each thread
+  inputFilename = val;
+  SetParticleSource("fromTree");
 }
-void PrimaryGeneratorAction::GetGPS(G4ThreeVector &position,
-                                    G4ThreeVector &direction,
-                                    G4double &energy) {
-  // noted that this dosen't work with older versions of geant4
-  if (particleSource == "") {
-    position = fParticleSource->GetParticlePosition();
-    direction = fParticleSource->GetParticleMomentumDirection();
-    energy = fParticleSource->GetParticleEnergy() / keV;
-  } else {
-    position = fParticleGun->GetParticlePosition();
-    direction = fParticleGun->GetParticleMomentumDirection();
-    energy = fParticleGun->GetParticleEnergy() / keV;
-  }
+
+void PrimaryGeneratorAction::SetPhaseSpaceInput(
+    G4String files, const std::vector<Long64_t> *historyStart, G4int numUses,
+    G4bool rotate) {
+  delete fPhaseSpace;
+  fPhaseSpace = new PhaseSpaceSource(files, historyStart, numUses, rotate);
+  SetParticleSource("fromPhaseSpace");
 }
 
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event *anEvent) {
   G4double energy;
-  G4double rnd;
-  G4double phi, theta, px, py, pz, radius;
+  G4double phi, radius;
   G4double sourcePlaneRadius = 157 / 2;
   //
+  AnalysisManager::GetInstance()->SeedEvent(anEvent->GetEventID());
+  if (numRays > 0) {
+    // the event is left without primaries
+    TraceRays();
+    return;
+  }
 
   // particleTable->FindParticle("gamma");
   // fParticleGun->SetParticleDefinition(particle);
 
-  if (particleSource == "Ba133") {
-    G4int numGamma = 0;
-
+  if (fLineSource) {
     phi = 2.0 * 3.14159 * (G4UniformRand());
     radius = sourcePlaneRadius * sqrt(G4UniformRand()) * mm;
     G4double shiftY = radius * cos(phi);
@@ -146,38 +139,174 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *anEvent) {
     // generate source on the surface of Kapton foil
     fParticleGun->SetParticlePosition(sourcePos);
 
-    while (numGamma == 0) {
-      for (G4int i = 0; i < NUM_GAMMAS; i++) {
-        rnd = 100 * G4UniformRand();
-        if (rnd < prob[i]) {
-          phi = 2.0 * 3.14159 * (G4UniformRand());
-          theta = acos(2 * G4UniformRand() - 1);
-          px = cos(phi) * sin(theta);
-          py = sin(phi) * sin(theta);
-          pz = cos(theta);
-
-          fParticleGun->SetParticleMomentumDirection(G4ThreeVector(px, py, pz));
-          energy = gammaEnergy[i];
-          fParticleGun->SetParticleEnergy(energy * keV);
-          fParticleGun->GeneratePrimaryVertex(anEvent);
-          numGamma++;
-        }
-      }
+    // decays without photons are skipped, the multiplicity is at least 1
+    G4int numGamma = fLineSource->SampleMultiplicity(G4UniformRand());
+    for (G4int i = 0; i < numGamma; i++) {
+      fParticleGun->SetParticleMomentumDirection(G4RandomDirection());
+      energy = fLineSource->SampleEnergy(G4UniformRand());
+      fParticleGun->SetParticleEnergy(energy * keV);
+      fParticleGun->GeneratePrimaryVertex(anEvent);
     }
 
-    // G4cout<<numGamma<<G4endl;
-
     iEntry++;
     if (iEntry % 10000 == 0) {
-      G4cout << "ba133 source" << G4endl;
+      G4cout << particleSource << " source" << G4endl;
     }
   }
-  else if (particleSource=="fromROOT"){
-          fParticleGun->GeneratePrimaryVertex(anEvent);
+  else if (particleSource == "fromTree") {
+    ReplayParticle(anEvent);
+  }
+  else if (particleSource == "fromPhaseSpace") {
+    Long64_t globalEventID =
+        AnalysisManager::GetInstance()->GetGlobalEventID(anEvent->GetEventID());
+    if (!fPhaseSpace->GeneratePrimary(fParticleGun, anEvent, globalEventID)) {
+      G4cout << "Event " << globalEventID
+             << " is beyond the phase space records, the run is aborted"
+             << G4endl;
+      G4RunManager::GetRunManager()->AbortRun(true);
+    }
   }
   else {
     fParticleSource->GeneratePrimaryVertex(anEvent);
+    G4PrimaryVertex *vertex =
+        anEvent->GetPrimaryVertex(anEvent->GetNumberOfPrimaryVertex() - 1);
+    if (apertureBias > 0) {
+      vertex->SetWeight(vertex->GetWeight() * BiasVertex(vertex));
+    }
+    if (fSpectrum) {
+      // the GPS gives the position and direction, the energy is sampled
+      // here; the GPS ignores energies set before its own sampling
+      for (G4PrimaryParticle *primary = vertex->GetPrimary(); primary;
+           primary = primary->GetNext()) {
+        G4double u1 = G4UniformRand();
+        G4double u2 = G4UniformRand();
+        primary->SetKineticEnergy(fSpectrum->Sample(u1, u2) * keV);
+      }
+    }
+  }
+}
+
+void PrimaryGeneratorAction::TraceRays() {
+  // the geometry is closed by now, the tracer is created by the first event
+  // of each thread
+  if (!fRayTracer)
+    fRayTracer = new RayTracer();
+  AnalysisManager *analysisManager = AnalysisManager::GetInstance();
+  G4Event rays;
+  for (G4int i = 0; i < numRays; i++) {
+    fParticleSource->GeneratePrimaryVertex(&rays);
+  }
+  for (G4int i = 0; i < rays.GetNumberOfPrimaryVertex(); i++) {
+    G4PrimaryVertex *vertex = rays.GetPrimaryVertex(i);
+    G4double weight = apertureBias > 0 ? BiasVertex(vertex) : 1;
+    for (G4PrimaryParticle *primary = vertex->GetPrimary(); primary;
+         primary = primary->GetNext()) {
+      G4double energy = primary->GetKineticEnergy();
+      if (fSpectrum) {
+        G4double u1 = G4UniformRand();
+        G4double u2 = G4UniformRand();
+        energy = fSpectrum->Sample(u1, u2) * keV;
+      }
+      G4ThreeVector hitPosition;
+      G4double transmission =
+          fRayTracer->Trace(vertex->GetPosition(),
+                            primary->GetMomentumDirection(), energy,
+                            hitPosition);
+      if (transmission > 0)
+        analysisManager->FillDetectorMap(hitPosition, weight * transmission);
+    }
+  }
+}
+
+G4double PrimaryGeneratorAction::BiasVertex(G4PrimaryVertex *vertex) {
+  // the weights are only right for a uniform, unrotated rectangle; the
+  // direction of the first primary is used for the whole vertex
+  G4SPSPosDistribution *posDist =
+      fParticleSource->GetCurrentSource()->GetPosDist();
+  if (fParticleSource->GetNumberOfSource() != 1 ||
+      posDist->GetPosDisType() != "Plane" ||
+      (posDist->GetPosDisShape() != "Square" &&
+       posDist->GetPosDisShape() != "Rectangle") ||
+      posDist->GetRotx() != G4ThreeVector(1, 0, 0) ||
+      posDist->GetRoty() != G4ThreeVector(0, 1, 0)) {
+    G4Exception("PrimaryGeneratorAction::BiasVertex()", "Gen005",
+                FatalException,
+                "Aperture biasing needs a single GPS source of type Plane, "
+                "shape Square or Rectangle, without rotation");
   }
+  // the geometry is closed by now
+  if (!fAperture)
+    fAperture = new ApertureSampler(apertureBias);
+  G4ThreeVector centre = posDist->GetCentreCoords();
+  G4ThreeVector pos = vertex->GetPosition();
+  G4double weight =
+      fAperture->Sample(pos, vertex->GetPrimary()->GetMomentumDirection(),
+                        centre.x() - posDist->GetHalfX(),
+                        centre.x() + posDist->GetHalfX());
+  vertex->SetPosition(pos.x(), pos.y(), pos.z());
+  return weight;
 }
 
-G4bool PrimaryGeneratorAction::InitFile() {}
+void PrimaryGeneratorAction::ReplayParticle(G4Event *anEvent) {
+  if (!ts && !InitFile()) {
+    G4Exception("PrimaryGeneratorAction::ReplayParticle()", "Gen002",
+                FatalException, ("Can not read " + inputFilename).c_str());
+  }
+  // entries follow the global event IDs, so threads and shards read
+  // disjoint entries, and the blocks of events of a thread are contiguous
+  // ranges for the tree cache
+  Long64_t entry =
+      AnalysisManager::GetInstance()->GetGlobalEventID(anEvent->GetEventID());
+  if (entry >= nEntries) {
+    G4cout << "Event " << entry << " is beyond the " << nEntries
+           << " entries of " << inputFilename << ", the run is aborted"
+           << G4endl;
+    G4RunManager::GetRunManager()->AbortRun(true);
+    return;
+  }
+  ts->GetEntry(entry);
+
+  G4ParticleDefinition *particle =
+      particleTable->FindParticle(G4String(ts->particle_name));
+  if (!particle) {
+    G4cout << "Unknown particle " << ts->particle_name << " in entry "
+           << entry << G4endl;
+    return;
+  }
+  fParticleGun->SetParticleDefinition(particle);
+  fParticleGun->SetParticleEnergy(ts->energy * keV);
+  fParticleGun->SetParticleTime(ts->time * ns);
+  fParticleGun->SetParticlePosition(G4ThreeVector(
+      ts->position[0] * mm, ts->position[1] * mm, ts->position[2] * mm));
+  fParticleGun->SetParticleMomentumDirection(
+      G4ThreeVector(ts->direction[0], ts->direction[1], ts->direction[2]));
+  fParticleGun->SetParticlePolarization(G4ThreeVector(
+      ts->polarization[0], ts->polarization[1], ts->polarization[2]));
+  fParticleGun->GeneratePrimaryVertex(anEvent);
+  iEntry++;
+}
+
+G4bool PrimaryGeneratorAction::InitFile() {
+  // one chain per thread, ROOT thread safety is enabled in MT mode
+  TChain *chain = new TChain("t2sim");
+  std::istringstream patterns(inputFilename);
+  std::string pattern;
+  while (std::getline(patterns, pattern, ',')) {
+    if (pattern != "")
+      chain->Add(pattern.c_str());
+  }
+  nEntries = chain->GetEntries();
+  if (nEntries <= 0) {
+    delete chain;
+    return false;
+  }
+  // the cache prefetches whole baskets of all branches
+  chain->SetCacheSize(64 * 1024 * 1024);
+  chain->AddBranchToCache("*", kTRUE);
+  chain->StopCacheLearningPhase();
+  fTree = chain;
+  ts = new t2sim(chain);
+  G4cout << "Replaying " << nEntries << " particles from " << inputFilename
+         << G4endl;
+  return true;
+}
@@ -0,0 +1,62 @@
+/***************************************************************
+ * Ray tracing of uncollided photons to the detector plane
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "RayTracer.hh"
+
+#include <cmath>
+
+#include "AttenuationTable.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Navigator.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+
+// rays attenuated more than exp(-50) are dropped
+#define MAX_OPTICAL_DEPTH 50
+
+RayTracer::RayTracer() {
+  fNavigator = new G4Navigator();
+  fNavigator->SetWorldVolume(G4TransportationManager::GetTransportationManager()
+                                 ->GetNavigatorForTracking()
+                                 ->GetWorldVolume());
+  fTable = new AttenuationTable(1 * keV, 10 * MeV, 3000);
+  fDetectorLog =
+      G4LogicalVolumeStore::GetInstance()->GetVolume("detectorBox", false);
+}
+
+RayTracer::~RayTracer() {
+  delete fNavigator;
+  delete fTable;
+}
+
+G4double RayTracer::Trace(const G4ThreeVector &position,
+                          const G4ThreeVector &direction, G4double energy,
+                          G4ThreeVector &hitPosition) {
+  G4ThreeVector pos = position;
+  G4double opticalDepth = 0;
+  G4VPhysicalVolume *pv =
+      fNavigator->LocateGlobalPointAndSetup(pos, &direction, false, false);
+  for (int i = 0; i < 100000 && pv; i++) {
+    G4LogicalVolume *log = pv->GetLogicalVolume();
+    if (log == fDetectorLog) {
+      hitPosition = pos;
+      return std::exp(-opticalDepth);
+    }
+    G4double safety;
+    G4double step = fNavigator->ComputeStep(pos, direction, kInfinity, safety);
+    if (step == kInfinity)
+      break;
+    opticalDepth += fTable->GetAttenuation(log->GetMaterial(), energy) * step;
+    if (opticalDepth > MAX_OPTICAL_DEPTH)
+      break;
+    pos += step * direction;
+    fNavigator->SetGeometricallyLimitedStep();
+    pv = fNavigator->LocateGlobalPointAndSetup(pos, &direction, true, false);
+  }
+  return 0;
+}
@@ -10,23 +10,41 @@
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
 #include "G4UnitsTable.hh"
+#include "XrayFluoPhysicsList.hh"
 #include "stdlib.h"
 using namespace std;
 
-RunAction::RunAction() : G4UserRunAction() {}
+RunAction::RunAction() : G4UserRunAction() { fTimer = new G4Timer(); }
 
-RunAction::~RunAction() {}
+RunAction::~RunAction() { delete fTimer; }
 
 void RunAction::BeginOfRunAction(const G4Run *run) {
   G4cout << "### Run " << run->GetRunID() << " start." << G4endl;
+  if (IsMaster()) {
+    // the tables are built before the run starts
+    XrayFluoPhysicsList *physicsList =
+        dynamic_cast<XrayFluoPhysicsList *>(const_cast<G4VUserPhysicsList *>(
+            G4RunManager::GetRunManager()->GetUserPhysicsList()));
+    if (physicsList)
+      physicsList->StorePhysicsTableCache();
+  }
   AnalysisManager *analysisManager = AnalysisManager::GetInstance();
   analysisManager->InitRun(run);
+  fTimer->Start();
 }
 
 void RunAction::EndOfRunAction(const G4Run *aRun) {
   AnalysisManager *analysisManager = AnalysisManager::GetInstance();
+  fTimer->Stop();
   analysisManager->ProcessRun(aRun);
 
+  if (IsMaster() && fTimer->GetRealElapsed() > 0) {
+    G4cout << "### Events processed: " << aRun->GetNumberOfEvent() << " in "
+           << fTimer->GetRealElapsed() << " s ("
+           << aRun->GetNumberOfEvent() / fTimer->GetRealElapsed()
+           << " events/s)" << G4endl;
+  }
   G4cout << "### This run is finished." << G4endl;
 }
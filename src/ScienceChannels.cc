@@ -0,0 +1,40 @@
+/***************************************************************
+ * STIX science energy channels
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "ScienceChannels.hh"
+
+#include "TAxis.h"
+#include "TH1.h"
+
+const double SCIENCE_ENERGY_EDGES[NUM_SCIENCE_CHANNELS + 1] = {
+    0,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13,  14,  15,  16,  18,  20, 22,
+    25, 28, 32, 36, 40, 45, 50, 56, 63, 70, 76, 84, 100, 120, 150, 250};
+
+int GetScienceChannel(double energy) {
+  if (energy < 4) {
+    return 0;
+  } else if (energy >= 150) {
+    return 31;
+  }
+  for (int i = 0; i < 31; i++) {
+    if (energy >= SCIENCE_ENERGY_EDGES[i] &&
+        energy < SCIENCE_ENERGY_EDGES[i + 1])
+      return i;
+  }
+  return 31;
+}
+
+bool NormalizeScienceSpectrum(TH1 *h) {
+  // energy bin widths are different, the counts are divided by the widths
+  if (h->GetXaxis()->GetNbins() != NUM_SCIENCE_CHANNELS)
+    return false;
+  for (int i = 0; i < NUM_SCIENCE_CHANNELS; i++) {
+    double binW = SCIENCE_ENERGY_EDGES[i + 1] - SCIENCE_ENERGY_EDGES[i];
+    h->SetBinContent(i + 1, h->GetBinContent(i + 1) / binW);
+    h->SetBinError(i + 1, h->GetBinError(i + 1) / binW);
+  }
+  return true;
+}
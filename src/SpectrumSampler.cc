@@ -0,0 +1,98 @@
+/***************************************************************
+ * Energy spectra sampled from histograms
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "SpectrumSampler.hh"
+
+#include <cmath>
+#include <iostream>
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+
+SpectrumSampler::SpectrumSampler() : fInterpolate(false) {}
+
+bool SpectrumSampler::Load(const TString &name) {
+  TString filename = name;
+  TString histName = "";
+  Ssiz_t colon = name.Last(':');
+  if (colon > 0 && name.EndsWith(".root") == kFALSE) {
+    filename = name(0, colon);
+    histName = name(colon + 1, name.Length());
+  }
+  TFile f(filename.Data());
+  if (f.IsZombie()) {
+    std::cout << "Can not open spectrum file " << filename << std::endl;
+    return false;
+  }
+  TH1 *h = NULL;
+  if (histName != "") {
+    h = dynamic_cast<TH1 *>(f.Get(histName.Data()));
+  } else {
+    TIter next(f.GetListOfKeys());
+    TKey *key;
+    while (!h && (key = (TKey *)next())) {
+      h = dynamic_cast<TH1 *>(key->ReadObj());
+    }
+  }
+  if (!h) {
+    std::cout << "No spectrum histogram in " << name << std::endl;
+    return false;
+  }
+
+  int n = h->GetNbinsX();
+  if (n < 1) {
+    std::cout << "Spectrum " << name << " has no bins" << std::endl;
+    return false;
+  }
+  fEdges.resize(n + 1);
+  std::vector<double> contents(n), densities(n);
+  double total = 0;
+  for (int i = 0; i < n; i++) {
+    fEdges[i] = h->GetXaxis()->GetBinLowEdge(i + 1);
+    contents[i] = h->GetBinContent(i + 1);
+    if (contents[i] < 0)
+      contents[i] = 0;
+    total += contents[i];
+    densities[i] = contents[i] / h->GetXaxis()->GetBinWidth(i + 1);
+  }
+  fEdges[n] = h->GetXaxis()->GetBinUpEdge(n);
+  // the alias table would sample a flat spectrum
+  if (total <= 0) {
+    std::cout << "Spectrum " << name << " has no positive bin content"
+              << std::endl;
+    return false;
+  }
+  // densities at the edges, the shape inside a bin is normalized to its
+  // content when sampling
+  fEdgeDensities.resize(n + 1);
+  fEdgeDensities[0] = densities[0];
+  fEdgeDensities[n] = densities[n - 1];
+  for (int i = 1; i < n; i++) {
+    fEdgeDensities[i] = (densities[i - 1] + densities[i]) / 2;
+  }
+  fBins.Build(contents);
+  std::cout << "Spectrum " << h->GetName() << " of " << filename << ": " << n
+            << " bins, " << fEdges[0] << " - " << fEdges[n] << " keV"
+            << std::endl;
+  return true;
+}
+
+double SpectrumSampler::Sample(double u1, double u2) const {
+  int i = fBins.Sample(u1);
+  double low = fEdges[i];
+  double width = fEdges[i + 1] - low;
+  if (!fInterpolate)
+    return low + u2 * width;
+  // inverse CDF of the density a + (b - a) x on [0, 1]
+  double a = fEdgeDensities[i];
+  double b = fEdgeDensities[i + 1];
+  double x = u2;
+  if (std::fabs(b - a) > 1e-9 * (a + b)) {
+    x = (std::sqrt(a * a + (b * b - a * a) * u2) - a) / (b - a);
+  }
+  return low + x * width;
+}
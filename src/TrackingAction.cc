@@ -0,0 +1,17 @@
+/***************************************************************
+ * Tracking action, split copies of importance biased histories
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "TrackingAction.hh"
+
+#include "AnalysisManager.hh"
+
+TrackingAction::TrackingAction() : G4UserTrackingAction() {}
+
+TrackingAction::~TrackingAction() {}
+
+void TrackingAction::PreUserTrackingAction(const G4Track *track) {
+  AnalysisManager::GetInstance()->BeginTrack(track);
+}
@@ -54,11 +54,32 @@
 //#include "G4UAtomicDeexcitation.hh"
 
 #include "G4Decay.hh"
+#include "DetectorConstruction.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "G4GeometrySampler.hh"
+#include "G4ImportanceBiasing.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4Threading.hh"
+#include "ImportanceParallelWorld.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4ProcessManager.hh"
+#include "Fingerprint.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
 #include "G4UnitsTable.hh"
+#include "G4Version.hh"
+#include "XrayFluoRangeRejection.hh"
 #include "XrayFluoStepMax.hh"
 
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
 // Bosons
 #include "G4ChargedGeantino.hh"
 #include "G4Gamma.hh"
@@ -79,11 +100,36 @@
 #include "G4BaryonConstructor.hh"
 #include "G4IonConstructor.hh"
 #include "G4MesonConstructor.hh"
+#include "G4ProductionCuts.hh"
 #include "G4ProductionCutsTable.hh"
 #include "G4Proton.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+namespace {
+G4String GetRegionName(const G4String &name) {
+  if (name == "World")
+    return "DefaultRegionForTheWorld";
+  return name;
+}
+
+void RemoveDirectory(const G4String &dir) {
+  DIR *d = opendir(dir.c_str());
+  if (!d)
+    return;
+  struct dirent *entry;
+  while ((entry = readdir(d)) != NULL) {
+    G4String name = entry->d_name;
+    if (name != "." && name != "..")
+      unlink((dir + "/" + name).c_str());
+  }
+  closedir(d);
+  rmdir(dir.c_str());
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 XrayFluoPhysicsList::XrayFluoPhysicsList() : G4VModularPhysicsList() {
   pMessenger = new XrayFluoPhysicsListMessenger(this);
 
@@ -104,6 +150,9 @@ XrayFluoPhysicsList::XrayFluoPhysicsList() : G4VModularPhysicsList() {
   cutForElectron = defaultCutValue;
   cutForPositron = defaultCutValue;
   cutForProton = defaultCutValue;
+  tableCacheDir = "";
+  physicsTableDir = "";
+  tablesCached = false;
 
   SetVerboseLevel(1);
 
@@ -111,6 +160,16 @@ XrayFluoPhysicsList::XrayFluoPhysicsList() : G4VModularPhysicsList() {
   emName = G4String("emlivermore");
   //  AddPhysicsList(emName);
   emPhysicsList = new G4EmLivermorePhysics();
+  // lets the collimator fast simulation model see the photons
+  fastSimPhysics = new G4FastSimulationPhysics();
+  fastSimPhysics->ActivateFastSimulation("gamma");
+  // splitting and Russian roulette of photons in the importance cells of
+  // the parallel world, only constructed when the cells exist
+  importanceSampler = new G4GeometrySampler(
+      ImportanceParallelWorld::GetDefaultName(), "gamma");
+  importanceSampler->SetParallel(true);
+  importanceBiasing = new G4ImportanceBiasing(
+      importanceSampler, ImportanceParallelWorld::GetDefaultName());
   G4ProductionCutsTable::GetProductionCutsTable()->SetEnergyRange(250 * eV,
                                                                   1 * GeV);
   //   emPhysicsList = new G4EmStandardPhysics_option4();
@@ -120,6 +179,9 @@ XrayFluoPhysicsList::XrayFluoPhysicsList() : G4VModularPhysicsList() {
 
 XrayFluoPhysicsList::~XrayFluoPhysicsList() {
   delete emPhysicsList;
+  delete fastSimPhysics;
+  delete importanceBiasing;
+  delete importanceSampler;
   delete pMessenger;
 }
 
@@ -162,8 +224,11 @@ void XrayFluoPhysicsList::ConstructParticle() {
 void XrayFluoPhysicsList::ConstructProcess() {
   AddTransportation();
   emPhysicsList->ConstructProcess();
+  AddFastSimulation();
   AddDecay();
   AddStepMax();
+  AddRangeRejection();
+  AddImportanceBiasing();
 
   // Em options
   //
@@ -216,6 +281,42 @@ void XrayFluoPhysicsList::AddStepMax() {
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void XrayFluoPhysicsList::AddRangeRejection() {
+  // the thresholds are read when the physics tables are built, so that
+  // /phys/region/rangeRejection also works after the initialization
+  XrayFluoRangeRejection *rejection =
+      new XrayFluoRangeRejection(&rangeRejection);
+  G4ProcessManager *pmanager = G4Electron::Electron()->GetProcessManager();
+  pmanager->AddDiscreteProcess(rejection);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::AddFastSimulation() {
+  // without the model every gamma step would still query the fast
+  // simulation manager
+  const DetectorConstruction *detector =
+      dynamic_cast<const DetectorConstruction *>(
+          G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector || !detector->GetFastSimEnabled())
+    return;
+  fastSimPhysics->ConstructProcess();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::AddImportanceBiasing() {
+  // the workers share the detector construction of the master
+  const DetectorConstruction *detector =
+      dynamic_cast<const DetectorConstruction *>(
+          G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector || detector->GetImportanceLayers() <= 0)
+    return;
+  importanceBiasing->ConstructProcess();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void XrayFluoPhysicsList::AddPhysicsList(const G4String &name) {
   // this allows updating physics using macros
   if (verboseLevel > -1) {
@@ -279,13 +380,118 @@ void XrayFluoPhysicsList::SetCuts() {
   SetCutValue(cutForElectron, "e-");
   SetCutValue(cutForPositron, "e+");
 
+  std::map<G4String, G4double>::const_iterator it;
+  for (it = regionCuts.begin(); it != regionCuts.end(); ++it) {
+    ApplyRegionCut(it->first, it->second, true);
+  }
+
+  if (tableCacheDir != "") {
+    // the cuts are final here and the tables are only built after this
+    physicsTableDir =
+        tableCacheDir + "/physics_" + ComputePhysicsFingerprint();
+    struct stat st;
+    if (stat(physicsTableDir.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      G4cout << "PhysicsList: retrieving physics tables from "
+             << physicsTableDir << G4endl;
+      SetPhysicsTableRetrieved(physicsTableDir);
+      tablesCached = true;
+    } else {
+      G4cout << "PhysicsList: no physics tables in " << physicsTableDir
+             << ", they are built and stored" << G4endl;
+      ResetPhysicsTableRetrieved();
+      tablesCached = false;
+    }
+  }
+
   if (verboseLevel > 0)
     DumpCutValuesTable();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+G4String XrayFluoPhysicsList::ComputePhysicsFingerprint() {
+  std::ostringstream desc;
+  desc << std::setprecision(17) << "g4lisa-physics-1 " << G4VERSION_NUMBER
+       << " " << emName << "\n";
+  G4ProductionCutsTable *cutsTable =
+      G4ProductionCutsTable::GetProductionCutsTable();
+  desc << cutsTable->GetLowEdgeEnergy() << " "
+       << cutsTable->GetHighEdgeEnergy() << "\n";
+  G4RegionStore *regions = G4RegionStore::GetInstance();
+  for (size_t i = 0; i < regions->size(); i++) {
+    G4Region *region = (*regions)[i];
+    G4ProductionCuts *cuts = region->GetProductionCuts();
+    desc << region->GetName();
+    if (cuts) {
+      desc << " " << cuts->GetProductionCut("gamma") << " "
+           << cuts->GetProductionCut("e-") << " "
+           << cuts->GetProductionCut("e+") << " "
+           << cuts->GetProductionCut("proton");
+    }
+    desc << "\n";
+  }
+  DescribeMaterials(desc);
+  desc << *G4EmParameters::Instance();
+  return HashToHex(desc.str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::StorePhysicsTableCache() {
+  // called on the master after the tables were built for the first run.
+  // A mismatch of a retrieved table makes Geant4 build it again, the cache
+  // is then stored under the new fingerprint by the next start
+  if (tableCacheDir == "" || physicsTableDir == "" || tablesCached)
+    return;
+  tablesCached = true;
+  // the key must still describe the cuts and settings the tables were
+  // built with
+  if (physicsTableDir !=
+      tableCacheDir + "/physics_" + ComputePhysicsFingerprint()) {
+    G4cout << "PhysicsList: the physics settings changed after the "
+              "initialization, the tables are not stored"
+           << G4endl;
+    return;
+  }
+  mkdir(tableCacheDir.c_str(), 0755);
+  // other jobs may store the same tables at the same time
+  std::ostringstream tmpDir;
+  tmpDir << physicsTableDir << ".tmp" << getpid();
+  if (mkdir(tmpDir.str().c_str(), 0755) != 0 ||
+      !StorePhysicsTable(tmpDir.str())) {
+    G4cout << "PhysicsList: can not store physics tables in " << tmpDir.str()
+           << G4endl;
+    RemoveDirectory(tmpDir.str());
+    return;
+  }
+  if (rename(tmpDir.str().c_str(), physicsTableDir.c_str()) != 0) {
+    RemoveDirectory(tmpDir.str());
+    return;
+  }
+  G4cout << "PhysicsList: physics tables stored in " << physicsTableDir
+         << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::InvalidatePhysicsTableCache() {
+  // before the initialization SetCuts computes the key with the new
+  // values; the workers replay the commands, the cache is the master's
+  if (physicsTableDir == "" || !G4Threading::IsMasterThread() ||
+      G4StateManager::GetStateManager()->GetCurrentState() != G4State_Idle)
+    return;
+  G4cout << "PhysicsList: physics settings changed after the "
+            "initialization, the physics table cache is disabled for this job"
+         << G4endl;
+  physicsTableDir = "";
+  tablesCached = false;
+  ResetPhysicsTableRetrieved();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void XrayFluoPhysicsList::SetCutForGamma(G4double cut) {
+  InvalidatePhysicsTableCache();
   cutForGamma = cut;
   SetParticleCuts(cutForGamma, G4Gamma::Gamma());
 }
@@ -293,6 +499,7 @@ void XrayFluoPhysicsList::SetCutForGamma(G4double cut) {
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void XrayFluoPhysicsList::SetCutForElectron(G4double cut) {
+  InvalidatePhysicsTableCache();
   cutForElectron = cut;
   SetParticleCuts(cutForElectron, G4Electron::Electron());
 }
@@ -300,6 +507,7 @@ void XrayFluoPhysicsList::SetCutForElectron(G4double cut) {
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void XrayFluoPhysicsList::SetCutForPositron(G4double cut) {
+  InvalidatePhysicsTableCache();
   cutForPositron = cut;
   SetParticleCuts(cutForPositron, G4Positron::Positron());
 }
@@ -307,13 +515,73 @@ void XrayFluoPhysicsList::SetCutForPositron(G4double cut) {
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void XrayFluoPhysicsList::SetCutForProton(G4double cut) {
+  InvalidatePhysicsTableCache();
   cutForProton = cut;
   SetParticleCuts(cutForProton, G4Proton::Proton());
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void XrayFluoPhysicsList::SetRegionCut(const G4String &region, G4double cut) {
+  InvalidatePhysicsTableCache();
+  G4String name = GetRegionName(region);
+  regionCuts[name] = cut;
+  // regions are created with the geometry, before that the cut is only
+  // kept and applied in SetCuts
+  ApplyRegionCut(name, cut, false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::ApplyRegionCut(const G4String &name, G4double cut,
+                                         G4bool verbose) {
+  G4Region *region = G4RegionStore::GetInstance()->GetRegion(name, false);
+  if (!region) {
+    if (verbose) {
+      G4cout << "PhysicsList::SetCuts: region " << name << " not found"
+             << G4endl;
+    }
+    return;
+  }
+  SetParticleCuts(cut, "gamma", region);
+  SetParticleCuts(cut, "e-", region);
+  SetParticleCuts(cut, "e+", region);
+  if (verboseLevel > 0) {
+    G4cout << "PhysicsList::SetCuts: " << name << " "
+           << G4BestUnit(cut, "Length") << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::SetRangeRejection(const G4String &region,
+                                            G4double range) {
+  rangeRejection[GetRegionName(region)] = range;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void XrayFluoPhysicsList::SetWoodcockRegion(const G4String &region) {
+  // gammas in the region are tracked with the cross section of its densest
+  // material and fictitious interactions are rejected, so they do not stop
+  // at the slit walls. Woodcock tracking is part of the gamma general
+  // process, which is used by all the EM constructors when it is active
+#if G4VERSION_NUMBER >= 1120
+  G4EmParameters *param = G4EmParameters::Instance();
+  param->SetGeneralProcessActive(true);
+  param->SetWoodcockActiveRegion(GetRegionName(region));
+  G4cout << "PhysicsList: Woodcock tracking of gammas in region " << region
+         << G4endl;
+#else
+  G4cout << "PhysicsList: Woodcock tracking needs Geant4 11.2 or later, "
+         << region << " is tracked normally" << G4endl;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void XrayFluoPhysicsList::SetFluorescence(G4bool value) {
+  InvalidatePhysicsTableCache();
   G4VAtomDeexcitation *de = G4LossTableManager::Instance()->AtomDeexcitation();
   if (de) {
     de->SetFluo(value);
@@ -323,6 +591,7 @@ void XrayFluoPhysicsList::SetFluorescence(G4bool value) {
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void XrayFluoPhysicsList::SetPIXE(G4bool value) {
+  InvalidatePhysicsTableCache();
   G4VAtomDeexcitation *de = G4LossTableManager::Instance()->AtomDeexcitation();
   if (de) {
     de->SetPIXE(value);
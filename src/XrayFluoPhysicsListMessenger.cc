@@ -35,9 +35,13 @@
 #include "G4UIcmdWithABool.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcommand.hh"
 #include "G4UIdirectory.hh"
+#include "G4UIparameter.hh"
 #include "XrayFluoPhysicsList.hh"
 
+#include <sstream>
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 XrayFluoPhysicsListMessenger::XrayFluoPhysicsListMessenger(
@@ -88,6 +92,49 @@ XrayFluoPhysicsListMessenger::XrayFluoPhysicsListMessenger(
   pixeCmd->SetGuidance("Set PIXE on/off.");
   pixeCmd->SetParameterName("pixe", false);
   pixeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  regionDir = new G4UIdirectory("/phys/region/");
+  regionDir->SetGuidance("per region physics, regions: Collimator, "
+                         "Detector and World");
+
+  regionCutCmd = new G4UIcommand("/phys/region/setCut", this);
+  regionCutCmd->SetGuidance("Set the gamma, e- and e+ cuts of a region.");
+  G4UIparameter *regionPrm = new G4UIparameter("region", 's', false);
+  regionCutCmd->SetParameter(regionPrm);
+  G4UIparameter *cutPrm = new G4UIparameter("cut", 'd', false);
+  cutPrm->SetParameterRange("cut>0.");
+  regionCutCmd->SetParameter(cutPrm);
+  G4UIparameter *unitPrm = new G4UIparameter("unit", 's', true);
+  unitPrm->SetDefaultValue("mm");
+  regionCutCmd->SetParameter(unitPrm);
+  regionCutCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  rangeRejectionCmd = new G4UIcommand("/phys/region/rangeRejection", this);
+  rangeRejectionCmd->SetGuidance(
+      "Kill electrons in a region if their range is below this value");
+  rangeRejectionCmd->SetGuidance(
+      "and the distance to the volume boundary, 0 to disable.");
+  regionPrm = new G4UIparameter("region", 's', false);
+  rangeRejectionCmd->SetParameter(regionPrm);
+  G4UIparameter *rangePrm = new G4UIparameter("range", 'd', false);
+  rangePrm->SetParameterRange("range>=0.");
+  rangeRejectionCmd->SetParameter(rangePrm);
+  unitPrm = new G4UIparameter("unit", 's', true);
+  unitPrm->SetDefaultValue("mm");
+  rangeRejectionCmd->SetParameter(unitPrm);
+  rangeRejectionCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  woodcockCmd = new G4UIcmdWithAString("/phys/region/woodcock", this);
+  woodcockCmd->SetGuidance("Use Woodcock tracking for gammas in a region.");
+  woodcockCmd->SetParameterName("region", false);
+  woodcockCmd->AvailableForStates(G4State_PreInit);
+
+  tableCacheCmd = new G4UIcmdWithAString("/phys/tableCacheDir", this);
+  tableCacheCmd->SetGuidance("Store the physics tables in this directory and");
+  tableCacheCmd->SetGuidance(
+      "retrieve them on the next start with the same materials and cuts.");
+  tableCacheCmd->SetParameterName("dir", false);
+  tableCacheCmd->AvailableForStates(G4State_PreInit);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -101,6 +148,11 @@ XrayFluoPhysicsListMessenger::~XrayFluoPhysicsListMessenger() {
   delete physDir;
   delete fluoCmd;
   delete pixeCmd;
+  delete regionCutCmd;
+  delete rangeRejectionCmd;
+  delete woodcockCmd;
+  delete tableCacheCmd;
+  delete regionDir;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -133,6 +185,27 @@ void XrayFluoPhysicsListMessenger::SetNewValue(G4UIcommand *command,
     pPhysicsList->SetCutForProton(cut);
   }
 
+  if (command == regionCutCmd || command == rangeRejectionCmd) {
+    G4String region, unit;
+    G4double value;
+    std::istringstream is(newValue);
+    is >> region >> value >> unit;
+    value *= G4UIcommand::ValueOf(unit);
+    if (command == regionCutCmd) {
+      pPhysicsList->SetRegionCut(region, value);
+    } else {
+      pPhysicsList->SetRangeRejection(region, value);
+    }
+  }
+
+  if (command == woodcockCmd) {
+    pPhysicsList->SetWoodcockRegion(newValue);
+  }
+
+  if (command == tableCacheCmd) {
+    pPhysicsList->SetPhysicsTableCacheDir(newValue);
+  }
+
   // Notify the run manager that the physics has been modified
   G4RunManager::GetRunManager()->PhysicsHasBeenModified();
 
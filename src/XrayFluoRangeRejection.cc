@@ -0,0 +1,78 @@
+/***************************************************************
+ * Electron range rejection per region
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ ***************************************************************/
+#include "XrayFluoRangeRejection.hh"
+
+#include "G4Electron.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LossTableManager.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VPhysicalVolume.hh"
+
+XrayFluoRangeRejection::XrayFluoRangeRejection(
+    const std::map<G4String, G4double> *thresholds,
+    const G4String &processName)
+    : G4VDiscreteProcess(processName, fUserDefined),
+      fThresholdsByName(thresholds) {}
+
+XrayFluoRangeRejection::~XrayFluoRangeRejection() {}
+
+G4bool XrayFluoRangeRejection::IsApplicable(
+    const G4ParticleDefinition &particle) {
+  return (&particle == G4Electron::Electron());
+}
+
+void XrayFluoRangeRejection::BuildPhysicsTable(const G4ParticleDefinition &) {
+  // regions only exist after the geometry is built, the names are
+  // resolved here so that the stepping does not compare strings
+  fThresholds.clear();
+  G4RegionStore *regions = G4RegionStore::GetInstance();
+  std::map<G4String, G4double>::const_iterator it;
+  for (it = fThresholdsByName->begin(); it != fThresholdsByName->end(); ++it) {
+    G4Region *region = regions->GetRegion(it->first, false);
+    if (!region) {
+      G4cout << "Range rejection: region " << it->first << " not found"
+             << G4endl;
+      continue;
+    }
+    fThresholds[region] = it->second;
+    G4cout << "Range rejection in region " << it->first << ": "
+           << it->second / mm << " mm" << G4endl;
+  }
+}
+
+G4double XrayFluoRangeRejection::PostStepGetPhysicalInteractionLength(
+    const G4Track &track, G4double, G4ForceCondition *condition) {
+  *condition = NotForced;
+  if (fThresholds.empty())
+    return DBL_MAX;
+
+  const G4Region *region = track.GetVolume()->GetLogicalVolume()->GetRegion();
+  std::map<const G4Region *, G4double>::const_iterator it =
+      fThresholds.find(region);
+  if (it == fThresholds.end())
+    return DBL_MAX;
+
+  G4double range = G4LossTableManager::Instance()->GetRange(
+      track.GetDefinition(), track.GetKineticEnergy(),
+      track.GetMaterialCutsCouple());
+  // safety at the start of this step
+  G4double safety = track.GetStep()->GetPreStepPoint()->GetSafety();
+  if (range < it->second && range < safety)
+    return 0.;
+  return DBL_MAX;
+}
+
+G4VParticleChange *XrayFluoRangeRejection::PostStepDoIt(const G4Track &aTrack,
+                                                        const G4Step &) {
+  aParticleChange.Initialize(aTrack);
+  aParticleChange.ProposeLocalEnergyDeposit(aTrack.GetKineticEnergy());
+  aParticleChange.ProposeEnergy(0.);
+  aParticleChange.ProposeTrackStatus(fStopAndKill);
+  return &aParticleChange;
+}
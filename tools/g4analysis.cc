@@ -0,0 +1,275 @@
+/***************************************************************
+ * g4analysis: histograms of the events and inp trees of g4main outputs
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * Compiled replacement of analysis/process_root.py: the E0 vs deposited
+ * energy matrix of the pixels with deposits, exported to CSV with the
+ * same layout (rows: deposited energy bin centers, columns: photon
+ * energy bin centers), plus the deposited and recorded spectra of each
+ * pixel, their science channel rebinning as in AnalysisManager, and the
+ * hit map of the inp tree. The pixel spectra are named hEdepPixelN, ...,
+ * their sum has the g4main names hEdep32, ... The trees are read with
+ * RDataFrame, the event loops run on all the threads given by -j. The
+ * events tree is only filled by g4main --save-events.
+ ***************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "ROOT/RDataFrame.hxx"
+#include "OutputLayout.hh"
+#include "ROOT/RVec.hxx"
+#include "ScienceChannels.hh"
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TROOT.h"
+#include "TString.h"
+
+using ROOT::RVec;
+
+void Help() {
+  std::cout << "g4analysis: histograms of g4main outputs with RDataFrame"
+            << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4analysis -o OUTPUT.root [OPTIONS] INPUT1.root "
+               "[INPUT2.root ...]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " -j N          threads of the event loops, 0 for all cores, "
+               "default: 0"
+            << std::endl
+            << " --csv FILE    CSV export of the response matrix, default: "
+               "OUTPUT with .csv"
+            << std::endl
+            << " --bins N      bins per axis of the response matrix, "
+               "default: 1500"
+            << std::endl
+            << " --emax E      upper edge of the response matrix in keV, "
+               "default: 150"
+            << std::endl
+            << " Input file names may contain wildcards" << std::endl;
+}
+
+// same layout as the pandas export of process_root.py
+bool WriteCSV(const TString &filename, const TH2D *h) {
+  FILE *out = fopen(filename.Data(), "w");
+  if (!out) {
+    std::cout << "Can not create " << filename << std::endl;
+    return false;
+  }
+  fprintf(out, "Energy_Bin_Center");
+  for (int i = 1; i <= h->GetNbinsX(); i++)
+    fprintf(out, ",%.2f", h->GetXaxis()->GetBinCenter(i));
+  fprintf(out, "\n");
+  for (int j = 1; j <= h->GetNbinsY(); j++) {
+    fprintf(out, "%.2f", h->GetYaxis()->GetBinCenter(j));
+    for (int i = 1; i <= h->GetNbinsX(); i++)
+      fprintf(out, ",%g", h->GetBinContent(i, j));
+    fprintf(out, "\n");
+  }
+  fclose(out);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  TString outputFilename = "";
+  TString csvFilename = "";
+  std::vector<TString> inputs;
+  int numThreads = 0;
+  int numBins = 1500;
+  double maxEnergy = 150;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-o" && hasValue) {
+      outputFilename = argv[++i];
+    } else if (sel == "-j" && hasValue) {
+      numThreads = atoi(argv[++i]);
+    } else if (sel == "--csv" && hasValue) {
+      csvFilename = argv[++i];
+    } else if (sel == "--bins" && hasValue) {
+      numBins = atoi(argv[++i]);
+    } else if (sel == "--emax" && hasValue) {
+      maxEnergy = atof(argv[++i]);
+    } else if (sel.BeginsWith("-")) {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    } else {
+      inputs.push_back(sel);
+    }
+  }
+  if (!outputFilename.EndsWith(".root") || inputs.empty() || numBins < 1 ||
+      maxEnergy <= 0 || numThreads < 0) {
+    Help();
+    return 1;
+  }
+  if (csvFilename == "") {
+    csvFilename = outputFilename;
+    csvFilename.ReplaceAll(".root", ".csv");
+  }
+
+  // before any data frame is created
+  if (numThreads != 1)
+    ROOT::EnableImplicitMT(numThreads);
+
+  TChain events("events");
+  TChain inp("inp");
+  for (size_t i = 0; i < inputs.size(); i++) {
+    events.Add(inputs[i].Data());
+    inp.Add(inputs[i].Data());
+  }
+  if (events.GetEntries() <= 0) {
+    std::cout << "The events trees are empty, was g4main run with "
+                 "--save-events?"
+              << std::endl;
+    return 1;
+  }
+
+  // weights of all pixels, outputs without weights count 1
+  ROOT::RDataFrame eventFrame(events);
+  ROOT::RDF::RNode weighted = eventFrame;
+  if (eventFrame.HasColumn("channelWeight")) {
+    weighted = eventFrame.Alias("pixelWeights", "channelWeight");
+  } else {
+    weighted = eventFrame.Define(
+        "pixelWeights",
+        [](const RVec<double> &edep) { return RVec<double>(edep.size(), 1.); },
+        {"edep"});
+  }
+  // one entry per pixel with a deposit
+  auto hits =
+      weighted
+          .Filter([](const RVec<double> &edep) {
+            return ROOT::VecOps::Any(edep > 0);
+          },
+                  {"edep"}, "edep > 0")
+          .Define("hitWeight",
+                  [](const RVec<double> &edep, const RVec<double> &w) {
+                    return RVec<double>(w[edep > 0]);
+                  },
+                  {"edep", "pixelWeights"})
+          .Define("hitE0",
+                  [](double e0, const RVec<double> &edep) {
+                    return RVec<double>(ROOT::VecOps::Sum(edep > 0), e0);
+                  },
+                  {"E0", "edep"})
+          .Define("hitEdep",
+                  [](const RVec<double> &edep) {
+                    return RVec<double>(edep[edep > 0]);
+                  },
+                  {"edep"})
+          .Define("hitReal",
+                  [](const RVec<double> &edep, const RVec<double> &charge2) {
+                    return RVec<double>(charge2[edep > 0]);
+                  },
+                  {"edep", "charge2"});
+
+  auto response = hits.Histo2D<RVec<double>, RVec<double>, RVec<double> >(
+      {"hResponse", "Response; Photon energy (keV); Energy deposition (keV)",
+       numBins, 0, maxEnergy, numBins, 0, maxEnergy},
+      "hitE0", "hitEdep", "hitWeight");
+
+  // one per pixel, then the pixel sum, see OutputLayout.hh
+  std::vector<ROOT::RDF::RResultPtr<TH1D> > spectra;
+  for (int p = 0; p <= NUM_PIXELS; p++) {
+    TString edepColumn = "hitEdep", realColumn = "hitReal";
+    TString weightColumn = "hitWeight";
+    ROOT::RDF::RNode pixel = hits;
+    if (p < NUM_PIXELS) {
+      edepColumn = "pixelEdep";
+      realColumn = "pixelReal";
+      weightColumn = "pixelWeight";
+      pixel = hits.Filter([p](const RVec<double> &edep) { return edep[p] > 0; },
+                          {"edep"})
+                  .Define("pixelEdep",
+                          [p](const RVec<double> &edep) { return edep[p]; },
+                          {"edep"})
+                  .Define("pixelReal",
+                          [p](const RVec<double> &charge2) {
+                            return charge2[p];
+                          },
+                          {"charge2"})
+                  .Define("pixelWeight",
+                          [p](const RVec<double> &w) { return w[p]; },
+                          {"pixelWeights"});
+    }
+    for (int s = 0; s < NUM_PIXEL_SPECTRA; s++) {
+      TString name = GetPixelSpectrumName(s, p);
+      TString title = GetPixelSpectrumTitle(s, p);
+      ROOT::RDF::TH1DModel model =
+          IsScienceSpectrum(s)
+              ? ROOT::RDF::TH1DModel(name, title, NUM_SCIENCE_CHANNELS,
+                                     SCIENCE_ENERGY_EDGES)
+              : ROOT::RDF::TH1DModel(name, title, SPECTRUM_NUM_BINS, 0,
+                                     SPECTRUM_MAX_ENERGY);
+      bool recorded = s == kRealSpectrum || s == kRealSciSpectrum;
+      spectra.push_back(
+          pixel.Histo1D(model, (recorded ? realColumn : edepColumn).Data(),
+                        weightColumn.Data()));
+    }
+  }
+
+  // hit map in the x-y plane of the detector, as h2xy of g4main; the inp
+  // tree is optional
+  ROOT::RDF::RResultPtr<TH2D> map;
+  bool hasMap = inp.GetEntries() > 0;
+  ROOT::RDataFrame inpFrame(inp);
+  if (hasMap) {
+    ROOT::RDF::RNode node =
+        inpFrame
+            .Define("mapX", [](const RVec<double> &pos) { return pos[0]; },
+                    {"pos"})
+            .Define("mapY",
+                    [](const RVec<double> &pos) {
+                      return pos[1] + PY_ORIGIN;
+                    },
+                    {"pos"});
+    TH2D model("h2xy", "Locations of hits; X (mm); Y(mm)", 1800, -90, 90,
+               1800, -90, 90);
+    map = inpFrame.HasColumn("weight")
+              ? node.Histo2D(model, "mapX", "mapY", "weight")
+              : node.Histo2D(model, "mapX", "mapY");
+  }
+
+  // the first access to a result runs the loop of its data frame, which
+  // fills all the histograms booked on it
+  std::cout << "Processing " << events.GetEntries() << " events";
+  if (hasMap)
+    std::cout << " and " << inp.GetEntries() << " detector entries";
+  std::cout << " with "
+            << (ROOT::IsImplicitMTEnabled() ? ROOT::GetThreadPoolSize() : 1)
+            << " threads"
+            << std::endl;
+
+  TFile out(outputFilename.Data(), "recreate");
+  if (out.IsZombie()) {
+    std::cout << "Can not create " << outputFilename << std::endl;
+    return 1;
+  }
+  response->Write();
+  for (size_t i = 0; i < spectra.size(); i++) {
+    TH1D *h = spectra[i].GetPtr();
+    if (IsScienceSpectrum(i % NUM_PIXEL_SPECTRA))
+      NormalizeScienceSpectrum(h);
+    h->Write();
+  }
+  if (hasMap)
+    map->Write();
+  out.Close();
+
+  if (!WriteCSV(csvFilename, response.GetPtr()))
+    return 1;
+  std::cout << "Wrote " << outputFilename << " and " << csvFilename
+            << std::endl;
+  return 0;
+}
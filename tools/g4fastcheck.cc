@@ -0,0 +1,195 @@
+/***************************************************************
+ * g4fastcheck: compare the photon spectra reaching the detector in
+ * g4main outputs with and without the collimator fast simulation
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * The fast simulation of the collimator treats scattering as absorption,
+ * so its results are only valid where the scattered photons do not
+ * matter. Run the same macro with /det/fastsim/enable false and true and
+ * compare the outputs: the photons of the inp tree, weighted, are counted
+ * per simulated event (hist/hNumEvents) in both sets of files, and the
+ * transmitted photons per event and the shape of their spectra are
+ * compared.
+ *
+ * The exit status is 1 when the transmissions differ by more than
+ * --max-sigma standard deviations or the chi2 test of the spectra gives
+ * a probability below --min-prob, so that the check can be scripted.
+ ***************************************************************/
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TH1D.h"
+#include "TObjArray.h"
+#include "TString.h"
+
+void Help() {
+  std::cout << "g4fastcheck: compare the transmitted spectra of full "
+               "tracking and fast simulation outputs"
+            << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4fastcheck --full FULL1.root [FULL2.root ...] --fast "
+               "FAST1.root [FAST2.root ...] [-o OUTPUT.root]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " --full          the following inputs are full tracking "
+               "outputs"
+            << std::endl
+            << " --fast          the following inputs are fast simulation "
+               "outputs"
+            << std::endl
+            << " -o OUTPUT.root  write the spectra of both sets" << std::endl
+            << " --bins N        spectrum bins, default: 300" << std::endl
+            << " --max-energy E  spectrum range [0, E] keV, default: 150"
+            << std::endl
+            << " --max-sigma S   largest accepted difference of the "
+               "transmissions, default: 3"
+            << std::endl
+            << " --min-prob P    smallest accepted chi2 probability of the "
+               "spectra, default: 0.01"
+            << std::endl
+            << " Input file names may contain wildcards" << std::endl;
+}
+
+// the spectrum of the photons reaching the detector, divided by the number
+// of simulated events of the inputs
+TH1D *FillSpectrum(const std::vector<TString> &inputs, const char *name,
+                   int numBins, double maxEnergy, double &numEvents) {
+  TChain chain("inp");
+  for (size_t i = 0; i < inputs.size(); i++) {
+    chain.Add(inputs[i].Data());
+  }
+  numEvents = 0;
+  TObjArray *files = chain.GetListOfFiles();
+  for (int i = 0; i < files->GetEntries(); i++) {
+    TFile f(files->At(i)->GetTitle());
+    TH1 *h = f.IsZombie() ? NULL : (TH1 *)f.Get("hist/hNumEvents");
+    if (!h) {
+      std::cout << "No hist/hNumEvents in " << files->At(i)->GetTitle()
+                << std::endl;
+      return NULL;
+    }
+    numEvents += h->GetBinContent(1);
+  }
+  if (numEvents <= 0) {
+    std::cout << "No simulated events in the " << name << " inputs"
+              << std::endl;
+    return NULL;
+  }
+
+  TH1D *h = new TH1D(name, Form("%s; Energy (keV); Photons per event", name),
+                     numBins, 0, maxEnergy);
+  h->SetDirectory(0);
+  h->Sumw2();
+  Double_t energy = 0;
+  Double_t weight = 1;
+  Int_t pdg = 0;
+  chain.SetBranchStatus("*", 0);
+  chain.SetBranchStatus("energy", 1);
+  chain.SetBranchStatus("pdg", 1);
+  chain.SetBranchAddress("energy", &energy);
+  chain.SetBranchAddress("pdg", &pdg);
+  // outputs written before the biasing have no weights
+  if (chain.GetBranch("weight")) {
+    chain.SetBranchStatus("weight", 1);
+    chain.SetBranchAddress("weight", &weight);
+  }
+  Long64_t numEntries = chain.GetEntries();
+  for (Long64_t i = 0; i < numEntries; i++) {
+    chain.GetEntry(i);
+    if (pdg == 22) {
+      h->Fill(energy, weight);
+    }
+  }
+  h->Scale(1. / numEvents);
+  return h;
+}
+
+int main(int argc, char **argv) {
+  TString outputFilename = "";
+  std::vector<TString> fullInputs, fastInputs;
+  std::vector<TString> *inputs = NULL;
+  int numBins = 300;
+  double maxEnergy = 150;
+  double maxSigma = 3;
+  double minProb = 0.01;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "--full") {
+      inputs = &fullInputs;
+    } else if (sel == "--fast") {
+      inputs = &fastInputs;
+    } else if (sel == "-o" && hasValue) {
+      outputFilename = argv[++i];
+    } else if (sel == "--bins" && hasValue) {
+      numBins = atoi(argv[++i]);
+    } else if (sel == "--max-energy" && hasValue) {
+      maxEnergy = atof(argv[++i]);
+    } else if (sel == "--max-sigma" && hasValue) {
+      maxSigma = atof(argv[++i]);
+    } else if (sel == "--min-prob" && hasValue) {
+      minProb = atof(argv[++i]);
+    } else if (sel.BeginsWith("-") || !inputs) {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    } else {
+      inputs->push_back(sel);
+    }
+  }
+  if (fullInputs.empty() || fastInputs.empty() || numBins < 1 ||
+      maxEnergy <= 0 || maxSigma <= 0 || minProb < 0 || minProb > 1 ||
+      (outputFilename != "" && !outputFilename.EndsWith(".root"))) {
+    Help();
+    return 1;
+  }
+
+  double fullEvents = 0, fastEvents = 0;
+  TH1D *hFull = FillSpectrum(fullInputs, "hFull", numBins, maxEnergy,
+                             fullEvents);
+  TH1D *hFast = FillSpectrum(fastInputs, "hFast", numBins, maxEnergy,
+                             fastEvents);
+  if (!hFull || !hFast) {
+    return 1;
+  }
+
+  double fullError = 0, fastError = 0;
+  double full = hFull->IntegralAndError(1, numBins, fullError);
+  double fast = hFast->IntegralAndError(1, numBins, fastError);
+  double error = std::sqrt(fullError * fullError + fastError * fastError);
+  double sigma = error > 0 ? (fast - full) / error : 0;
+  // the spectra are weighted, the test compares their shapes
+  double prob = full > 0 && fast > 0 ? hFull->Chi2Test(hFast, "WW") : 0;
+
+  std::cout << "Full tracking: " << fullEvents << " events, " << full
+            << " +- " << fullError << " photons per event" << std::endl;
+  std::cout << "Fast simulation: " << fastEvents << " events, " << fast
+            << " +- " << fastError << " photons per event" << std::endl;
+  std::cout << "Transmission difference: " << fast - full << " (" << sigma
+            << " sigma)" << std::endl;
+  std::cout << "Spectrum chi2 probability: " << prob << std::endl;
+
+  if (outputFilename != "") {
+    TFile f(outputFilename, "recreate");
+    hFull->Write();
+    hFast->Write();
+    f.Close();
+  }
+
+  bool passed = std::fabs(sigma) <= maxSigma && prob >= minProb;
+  std::cout << (passed ? "Passed" : "Failed") << std::endl;
+  delete hFull;
+  delete hFast;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,474 @@
+/***************************************************************
+ * g4fit: fit the detector response parameters to a measured spectrum
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * The hits trees of g4main --save-hits are loaded once, then Minuit2
+ * varies the Fano factor, the electronics noise and the near surface
+ * parameters R0 and L, and every evaluation digitizes all the cached
+ * deposits again on -j threads, as g4redigi does. The Hecht efficiency
+ * only depends on the high voltage, which is not fitted, so it is
+ * applied once at loading.
+ *
+ * The two Gaussian random numbers of every pixel deposit are drawn once
+ * and kept (common random numbers), so the objective is a deterministic
+ * function of the parameters. Each recorded energy is shared linearly
+ * between the two nearest bin centers of the measured spectrum, which
+ * makes the model continuous in the parameters, as Migrad needs, at the
+ * cost of a smearing of about one bin. The objective is the Poisson
+ * likelihood ratio of the measured counts in the fit range, with the
+ * model normalized to the measured counts; the errors do not include the
+ * statistics of the simulation.
+ ***************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DetectorResponse.hh"
+#include "Math/Factory.h"
+#include "Math/Functor.h"
+#include "Math/Minimizer.h"
+#include "OutputLayout.hh"
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TNamed.h"
+#include "TRandom3.h"
+#include "TString.h"
+
+const int NUM_PARAMETERS = 4;
+// DetectorResponse names and limits of the fitted parameters
+const char *PARAMETER_NAMES[NUM_PARAMETERS] = {"fano", "enoise", "r0", "l"};
+const double PARAMETER_MIN[NUM_PARAMETERS] = {1e-3, 1e-3, 0, 1e-5};
+const double PARAMETER_MAX[NUM_PARAMETERS] = {2, 5, 1, 0.1};
+
+void Help() {
+  std::cout << "g4fit: fit detector response parameters to a measured "
+               "spectrum with the hits of g4main --save-hits outputs"
+            << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4fit -m MEASURED.root[:HNAME] [OPTIONS] INPUT1.root "
+               "[INPUT2.root ...]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " -m FILE[:HNAME]   measured spectrum in keV, the first TH1 of "
+               "the file by default"
+            << std::endl
+            << " --range EMIN,EMAX fit range in keV, default: the range of "
+               "the measured spectrum"
+            << std::endl
+            << " --pixel N         only the deposits of pixel N, default: all"
+            << std::endl
+            << " --set NAME=VALUE  initial or fixed value: fano, enoise (keV), "
+               "r0, l (mm), hv (V)"
+            << std::endl
+            << " --fix NAME        keep fano, enoise, r0 or l fixed"
+            << std::endl
+            << " -j N              threads of the objective, default: all "
+               "cores"
+            << std::endl
+            << " --seed S          seed of the cached random numbers, "
+               "default: 0"
+            << std::endl
+            << " -o OUTPUT.root    measured and best fit spectra" << std::endl
+            << " Input file names may contain wildcards" << std::endl;
+}
+
+TH1 *LoadSpectrum(const TString &name) {
+  // same syntax as g4main -s
+  TString filename = name;
+  TString histName = "";
+  Ssiz_t colon = name.Last(':');
+  if (colon > 0 && name.EndsWith(".root") == kFALSE) {
+    filename = name(0, colon);
+    histName = name(colon + 1, name.Length());
+  }
+  TFile f(filename.Data());
+  if (f.IsZombie()) {
+    std::cout << "Can not open spectrum file " << filename << std::endl;
+    return NULL;
+  }
+  TH1 *h = NULL;
+  if (histName != "") {
+    h = dynamic_cast<TH1 *>(f.Get(histName.Data()));
+  } else {
+    TIter next(f.GetListOfKeys());
+    TKey *key;
+    while (!h && (key = (TKey *)next())) {
+      h = dynamic_cast<TH1 *>(key->ReadObj());
+    }
+  }
+  if (!h) {
+    std::cout << "No spectrum histogram in " << name << std::endl;
+    return NULL;
+  }
+  h = (TH1 *)h->Clone("hMeasured");
+  h->SetDirectory(0);
+  return h;
+}
+
+// all deposits of the selected pixels, in memory
+class SpectrumFit {
+public:
+  SpectrumFit(const DetectorResponse &response, const TH1 *measured,
+              double emin, double emax, int numThreads);
+
+  // returns false if there is no deposit
+  bool Load(TChain &chain, int pixel, unsigned long seed);
+  // par: fano, enoise, r0, l
+  double Evaluate(const double *par) const;
+  // recorded energies in the bins of the measured spectrum, normalized to
+  // the measured counts of the fit range
+  TH1 *GetModel(const double *par) const;
+
+  size_t GetNumDeposits() const {
+    return fFirstHit.empty() ? 0 : fFirstHit.size() - 1;
+  }
+  size_t GetNumHits() const { return fDepth.size(); }
+  long GetNumCalls() const { return fNumCalls; }
+  Long64_t GetNumTruncated() const { return fNumTruncated; }
+
+private:
+  DetectorResponse fResponse;
+  const TH1 *fTemplate;          // the measured spectrum
+  std::vector<double> fCenters;  // bin centers of the measured spectrum
+  std::vector<double> fMeasured; // counts
+  int fFirstBin, fLastBin;       // fit range, 0-based
+  int fNumThreads;
+  // hits of a deposit: fFirstHit[i] .. fFirstHit[i + 1] - 1
+  std::vector<int> fFirstHit;
+  std::vector<float> fDepth, fHechtEdep; // Hecht efficiency x edep
+  std::vector<float> fWeight, fZ1, fZ2;  // per deposit
+  Long64_t fNumTruncated; // events skipped, hits not stored by g4main
+  mutable long fNumCalls;
+
+  void Fill(const DetectorResponse &response, size_t first, size_t last,
+            std::vector<double> &model) const;
+  void FillModel(const double *par, std::vector<double> &model) const;
+};
+
+SpectrumFit::SpectrumFit(const DetectorResponse &response,
+                         const TH1 *measured, double emin, double emax,
+                         int numThreads)
+    : fResponse(response), fTemplate(measured), fNumThreads(numThreads),
+      fNumTruncated(0), fNumCalls(0) {
+  const TAxis *axis = measured->GetXaxis();
+  int n = measured->GetNbinsX();
+  fCenters.resize(n);
+  fMeasured.resize(n);
+  fFirstBin = n;
+  fLastBin = -1;
+  for (int i = 0; i < n; i++) {
+    fCenters[i] = axis->GetBinCenter(i + 1);
+    fMeasured[i] = std::max(0.0, measured->GetBinContent(i + 1));
+    if (fCenters[i] >= emin && fCenters[i] <= emax) {
+      fFirstBin = std::min(fFirstBin, i);
+      fLastBin = std::max(fLastBin, i);
+    }
+  }
+}
+
+bool SpectrumFit::Load(TChain &chain, int pixel, unsigned long seed) {
+  Int_t numHits;
+  Short_t hitPixel[MAX_HITS];
+  Float_t depth[MAX_HITS], edep[MAX_HITS], hitWeight[MAX_HITS];
+  chain.SetBranchStatus("*", false);
+  const char *branches[] = {"nHits", "pixel", "depth", "edep", "hitWeight"};
+  for (int i = 0; i < 5; i++)
+    chain.SetBranchStatus(branches[i], true);
+  chain.SetBranchAddress("nHits", &numHits);
+  chain.SetBranchAddress("pixel", hitPixel);
+  chain.SetBranchAddress("depth", depth);
+  chain.SetBranchAddress("edep", edep);
+  chain.SetBranchAddress("hitWeight", hitWeight);
+  // older outputs do not have the flag
+  Bool_t truncated = false;
+  if (chain.GetBranch("truncated")) {
+    chain.SetBranchStatus("truncated", true);
+    chain.SetBranchAddress("truncated", &truncated);
+  }
+
+  TRandom3 random(seed);
+  Long64_t numEntries = chain.GetEntries();
+  fNumTruncated = 0;
+  for (Long64_t entry = 0; entry < numEntries; entry++) {
+    chain.GetEntry(entry);
+    // incomplete deposits would bias the model
+    if (truncated) {
+      fNumTruncated++;
+      continue;
+    }
+    // the hits of each pixel form one deposit
+    for (int p = 0; p < NUM_PIXELS; p++) {
+      if (pixel >= 0 && p != pixel)
+        continue;
+      double sum = 0, weightSum = 0;
+      size_t first = fDepth.size();
+      for (int k = 0; k < numHits && k < MAX_HITS; k++) {
+        if (hitPixel[k] != p)
+          continue;
+        fDepth.push_back(depth[k]);
+        fHechtEdep.push_back(fResponse.GetCollectionEfficiency(depth[k]) *
+                             edep[k]);
+        sum += edep[k];
+        weightSum += edep[k] * hitWeight[k];
+      }
+      if (fDepth.size() == first)
+        continue;
+      fFirstHit.push_back(first);
+      // energy weighted mean of the hit weights, as AnalysisManager
+      fWeight.push_back(sum > 0 ? weightSum / sum : 0);
+      fZ1.push_back(random.Gaus());
+      fZ2.push_back(random.Gaus());
+    }
+  }
+  fFirstHit.push_back(fDepth.size());
+  return fFirstHit.size() > 1;
+}
+
+void SpectrumFit::Fill(const DetectorResponse &response, size_t first,
+                       size_t last, std::vector<double> &model) const {
+  int n = fCenters.size();
+  for (size_t i = first; i < last; i++) {
+    double collected = 0;
+    for (int k = fFirstHit[i]; k < fFirstHit[i + 1]; k++)
+      collected += response.GetNearSurfaceFactor(fDepth[k]) * fHechtEdep[k];
+    // DetectorResponse::Digitize with the cached random numbers
+    double charge =
+        collected + response.GetEnergyResolution(collected) * fZ1[i];
+    double charge2 = charge + response.GetNoise() * fZ2[i];
+    // linear sharing between the two nearest bin centers
+    int b = std::upper_bound(fCenters.begin(), fCenters.end(), charge2) -
+            fCenters.begin();
+    if (b == 0 || b == n)
+      continue;
+    double f = (charge2 - fCenters[b - 1]) / (fCenters[b] - fCenters[b - 1]);
+    model[b - 1] += fWeight[i] * (1 - f);
+    model[b] += fWeight[i] * f;
+  }
+}
+
+void SpectrumFit::FillModel(const double *par,
+                            std::vector<double> &model) const {
+  DetectorResponse response = fResponse;
+  for (int i = 0; i < NUM_PARAMETERS; i++)
+    response.SetParameter(PARAMETER_NAMES[i], par[i]);
+  size_t numDeposits = GetNumDeposits();
+  int numThreads = std::max(1, fNumThreads);
+  std::vector<std::vector<double> > partial(
+      numThreads, std::vector<double>(fCenters.size(), 0));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; t++) {
+    size_t first = numDeposits * t / numThreads;
+    size_t last = numDeposits * (t + 1) / numThreads;
+    threads.push_back(std::thread(&SpectrumFit::Fill, this,
+                                  std::cref(response), first, last,
+                                  std::ref(partial[t])));
+  }
+  model.assign(fCenters.size(), 0);
+  for (int t = 0; t < numThreads; t++) {
+    threads[t].join();
+    for (size_t i = 0; i < model.size(); i++)
+      model[i] += partial[t][i];
+  }
+  // normalized to the measured counts of the fit range
+  double measuredSum = 0, modelSum = 0;
+  for (int i = fFirstBin; i <= fLastBin; i++) {
+    measuredSum += fMeasured[i];
+    modelSum += model[i];
+  }
+  double scale = modelSum > 0 ? measuredSum / modelSum : 0;
+  for (size_t i = 0; i < model.size(); i++)
+    model[i] *= scale;
+}
+
+double SpectrumFit::Evaluate(const double *par) const {
+  fNumCalls++;
+  std::vector<double> model;
+  FillModel(par, model);
+  // -2 ln of the Poisson likelihood ratio
+  double chi2 = 0;
+  for (int i = fFirstBin; i <= fLastBin; i++) {
+    double mu = std::max(model[i], 1e-9);
+    chi2 += 2 * (mu - fMeasured[i]);
+    if (fMeasured[i] > 0)
+      chi2 += 2 * fMeasured[i] * log(fMeasured[i] / mu);
+  }
+  return chi2;
+}
+
+TH1 *SpectrumFit::GetModel(const double *par) const {
+  std::vector<double> model;
+  FillModel(par, model);
+  TH1 *h = (TH1 *)fTemplate->Clone("hModel");
+  h->SetDirectory(0);
+  h->Reset();
+  h->SetTitle("Best fit; Energy (keV); Counts");
+  for (size_t i = 0; i < model.size(); i++)
+    h->SetBinContent(i + 1, model[i]);
+  return h;
+}
+
+int main(int argc, char **argv) {
+  TString measuredName = "";
+  TString outputFilename = "";
+  std::vector<TString> inputs;
+  DetectorResponse response;
+  bool fixed[NUM_PARAMETERS] = {false, false, false, false};
+  double emin = -1e30, emax = 1e30;
+  int pixel = -1;
+  int numThreads = std::thread::hardware_concurrency();
+  unsigned long seed = 0;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-m" && hasValue) {
+      measuredName = argv[++i];
+    } else if (sel == "-o" && hasValue) {
+      outputFilename = argv[++i];
+    } else if (sel == "--range" && hasValue) {
+      char comma;
+      std::istringstream spec(argv[++i]);
+      if (!(spec >> emin >> comma >> emax) || comma != ',' || emax <= emin) {
+        std::cout << "Invalid fit range: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (sel == "--pixel" && hasValue) {
+      pixel = atoi(argv[++i]);
+    } else if (sel == "--set" && hasValue) {
+      if (!response.SetParameter(argv[++i])) {
+        std::cout << "Invalid parameter: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (sel == "--fix" && hasValue) {
+      TString name = argv[++i];
+      int p = 0;
+      while (p < NUM_PARAMETERS && name != PARAMETER_NAMES[p])
+        p++;
+      if (p == NUM_PARAMETERS) {
+        std::cout << "Can not fix " << name << std::endl;
+        return 1;
+      }
+      fixed[p] = true;
+    } else if (sel == "-j" && hasValue) {
+      numThreads = atoi(argv[++i]);
+    } else if (sel == "--seed" && hasValue) {
+      seed = strtoul(argv[++i], NULL, 10);
+    } else if (sel.BeginsWith("-")) {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    } else {
+      inputs.push_back(sel);
+    }
+  }
+  if (measuredName == "" || inputs.empty() || pixel >= NUM_PIXELS ||
+      (outputFilename != "" && !outputFilename.EndsWith(".root"))) {
+    Help();
+    return 1;
+  }
+  if (numThreads < 1)
+    numThreads = 1;
+
+  TH1 *measured = LoadSpectrum(measuredName);
+  if (!measured)
+    return 1;
+  SpectrumFit fit(response, measured, emin, emax, numThreads);
+
+  TChain chain("hits");
+  for (size_t i = 0; i < inputs.size(); i++) {
+    chain.Add(inputs[i].Data());
+  }
+  if (chain.GetEntries() <= 0 || !fit.Load(chain, pixel, seed)) {
+    std::cout << "No hits to fit, was g4main run with --save-hits?"
+              << std::endl;
+    return 1;
+  }
+  std::cout << "Loaded " << fit.GetNumDeposits() << " pixel deposits ("
+            << fit.GetNumHits() << " hits) of " << chain.GetEntries()
+            << " events, " << numThreads << " threads" << std::endl;
+  if (fit.GetNumTruncated() > 0) {
+    std::cout << "Skipped " << fit.GetNumTruncated()
+              << " events with more than " << MAX_HITS
+              << " hits, truncated by g4main" << std::endl;
+  }
+
+  double initial[NUM_PARAMETERS] = {
+      response.GetFanoFactor(), response.GetNoise(),
+      response.GetNearSurfaceR0(), response.GetNearSurfaceL()};
+  ROOT::Math::Minimizer *minimizer =
+      ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+  if (!minimizer) {
+    std::cout << "Minuit2 is not available" << std::endl;
+    return 1;
+  }
+  ROOT::Math::Functor objective(&fit, &SpectrumFit::Evaluate,
+                                NUM_PARAMETERS);
+  minimizer->SetFunction(objective);
+  minimizer->SetErrorDef(1);
+  minimizer->SetMaxFunctionCalls(10000);
+  minimizer->SetPrintLevel(1);
+  for (int i = 0; i < NUM_PARAMETERS; i++) {
+    double value = std::min(std::max(initial[i], PARAMETER_MIN[i]),
+                            PARAMETER_MAX[i]);
+    double step = std::max(0.1 * value, 1e-3 * PARAMETER_MAX[i]);
+    if (fixed[i]) {
+      minimizer->SetFixedVariable(i, PARAMETER_NAMES[i], value);
+    } else {
+      minimizer->SetLimitedVariable(i, PARAMETER_NAMES[i], value, step,
+                                    PARAMETER_MIN[i], PARAMETER_MAX[i]);
+    }
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  bool converged = minimizer->Minimize();
+  minimizer->Hesse();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  const double *best = minimizer->X();
+  const double *errors = minimizer->Errors();
+  std::cout << (converged ? "Converged" : "Did not converge") << " after "
+            << fit.GetNumCalls() << " evaluations, "
+            << 1000 * seconds / std::max(1L, fit.GetNumCalls())
+            << " ms per evaluation" << std::endl;
+  std::cout << "-2 ln L: " << minimizer->MinValue() << std::endl;
+  TString setOptions = "";
+  for (int i = 0; i < NUM_PARAMETERS; i++) {
+    std::cout << PARAMETER_NAMES[i] << " = " << best[i] << " +- "
+              << errors[i] << (fixed[i] ? " (fixed)" : "") << std::endl;
+    setOptions += Form(" --set %s=%g", PARAMETER_NAMES[i], best[i]);
+  }
+  std::cout << "g4redigi options:" << setOptions << std::endl;
+
+  if (outputFilename != "") {
+    TFile out(outputFilename.Data(), "recreate");
+    if (out.IsZombie()) {
+      std::cout << "Can not create " << outputFilename << std::endl;
+      return 1;
+    }
+    TH1 *model = fit.GetModel(best);
+    measured->Write();
+    model->Write();
+    TNamed result("fitResult", setOptions.Data());
+    result.Write();
+    out.Close();
+    std::cout << "Wrote " << outputFilename << std::endl;
+  }
+  delete minimizer;
+  return converged ? 0 : 1;
+}
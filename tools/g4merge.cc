@@ -0,0 +1,51 @@
+/***************************************************************
+ * g4merge: merge the outputs of several g4main runs
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * Usage: g4merge [-f] OUTPUT.root INPUT1.root INPUT2.root ...
+ ***************************************************************/
+#include <iostream>
+#include <vector>
+
+#include "OutputMerger.hh"
+#include "TString.h"
+#include "TSystem.h"
+
+void Help() {
+  std::cout << "g4merge: merge g4main output files" << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4merge [-f] OUTPUT.root INPUT1.root INPUT2.root ..."
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " -f      overwrite OUTPUT.root if it exists" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  bool force = false;
+  TString output = "";
+  std::vector<TString> inputs;
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-f") {
+      force = true;
+    } else if (output == "") {
+      output = sel;
+    } else {
+      inputs.push_back(sel);
+    }
+  }
+  if (output == "" || inputs.empty()) {
+    Help();
+    return 1;
+  }
+  if (!force && !gSystem->AccessPathName(output.Data())) {
+    std::cout << output << " exists, use -f to overwrite it" << std::endl;
+    return 1;
+  }
+  return MergeOutputFiles(inputs, output) ? 0 : 1;
+}
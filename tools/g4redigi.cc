@@ -0,0 +1,285 @@
+/***************************************************************
+ * g4redigi: digitize the hits of g4main --save-hits outputs again
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * The hits tree keeps the raw deposits of every step in the pixels
+ * (pixel, depth, edep, time, weight), so the charge collection, the Fano
+ * and electronics noise and the threshold can be applied again with other
+ * parameters without running Geant4. The events tree written here has the
+ * branches of the g4main one (edep, collected, charge, charge2, sci, ...)
+ * and can be read by g4analysis. The run seed of every input is read from
+ * its metadata, unless --seed is given; with the default parameters the
+ * digitization random streams are then the ones of g4main, the results
+ * only differ by the single precision of the stored hits. Events with
+ * more than MAX_HITS hits were truncated by g4main, they are counted and
+ * can be skipped. The spectra of each pixel are hEdepPixelN, hRealPixelN,
+ * ...; the pixel sum has the g4main names hEdep32, hReal32, ...
+ ***************************************************************/
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DetectorResponse.hh"
+#include "OutputLayout.hh"
+#include "ScienceChannels.hh"
+#include "TChain.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1F.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TRandom3.h"
+#include "TString.h"
+#include "TTree.h"
+
+void Help() {
+  std::cout << "g4redigi: digitize the hits trees of g4main outputs with "
+               "other detector parameters"
+            << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4redigi -o OUTPUT.root [OPTIONS] INPUT1.root "
+               "[INPUT2.root ...]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " --set NAME=VALUE  detector parameter, may be repeated: fano, "
+               "enoise (keV), threshold (keV), r0, l (mm), hv (V)"
+            << std::endl
+            << " --seed S          run seed of the simulation, default: the "
+               "one in the metadata of each input"
+            << std::endl
+            << " --skip-truncated  skip the events with hits not stored by "
+               "g4main"
+            << std::endl
+            << " Input file names may contain wildcards" << std::endl;
+}
+
+// the run seed written by AnalysisManager::CopyMacrosToROOT
+bool ReadRunSeed(const char *filename, long long &seed) {
+  TFile f(filename);
+  TNamed *metadata = f.IsZombie() ? NULL : (TNamed *)f.Get("metadata");
+  if (!metadata)
+    return false;
+  std::string text = metadata->GetTitle();
+  const std::string key = "Random seed: ";
+  size_t pos = text.find(key);
+  if (pos == std::string::npos)
+    return false;
+  seed = atoll(text.c_str() + pos + key.size());
+  return true;
+}
+
+int main(int argc, char **argv) {
+  TString outputFilename = "";
+  std::vector<TString> inputs;
+  DetectorResponse response;
+  long long seed = 0;
+  bool hasSeed = false;
+  bool skipTruncated = false;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-o" && hasValue) {
+      outputFilename = argv[++i];
+    } else if (sel == "--set" && hasValue) {
+      if (!response.SetParameter(argv[++i])) {
+        std::cout << "Invalid parameter: " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (sel == "--seed" && hasValue) {
+      seed = atoll(argv[++i]);
+      hasSeed = true;
+    } else if (sel == "--skip-truncated") {
+      skipTruncated = true;
+    } else if (sel.BeginsWith("-")) {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    } else {
+      inputs.push_back(sel);
+    }
+  }
+  if (!outputFilename.EndsWith(".root") || inputs.empty()) {
+    Help();
+    return 1;
+  }
+
+  TChain chain("hits");
+  for (size_t i = 0; i < inputs.size(); i++) {
+    chain.Add(inputs[i].Data());
+  }
+  Long64_t numEntries = chain.GetEntries();
+  if (numEntries <= 0) {
+    std::cout << "The hits trees are empty, was g4main run with --save-hits?"
+              << std::endl;
+    return 1;
+  }
+
+  // one seed per file of the chain
+  std::vector<long long> seeds;
+  TObjArray *files = chain.GetListOfFiles();
+  for (int i = 0; i < files->GetEntries(); i++) {
+    const char *filename = files->At(i)->GetTitle();
+    long long fileSeed = seed;
+    if (!hasSeed && !ReadRunSeed(filename, fileSeed)) {
+      std::cout << "No run seed in the metadata of " << filename
+                << ", give it with --seed" << std::endl;
+      return 1;
+    }
+    seeds.push_back(fileSeed);
+  }
+
+  Long64_t eventID;
+  Double_t gunEnergy, eventWeight;
+  Int_t numHits;
+  Short_t pixel[MAX_HITS];
+  Float_t depth[MAX_HITS], hitEdep[MAX_HITS], hitWeight[MAX_HITS];
+  Bool_t truncated = false;
+  // older outputs do not have the flag
+  bool hasTruncated = chain.GetBranch("truncated") != NULL;
+  chain.SetBranchStatus("*", false);
+  const char *branches[] = {"eventID", "E0",    "weight",   "nHits",
+                            "pixel",   "depth", "edep",     "hitWeight"};
+  for (int i = 0; i < 8; i++)
+    chain.SetBranchStatus(branches[i], true);
+  chain.SetBranchAddress("eventID", &eventID);
+  chain.SetBranchAddress("E0", &gunEnergy);
+  chain.SetBranchAddress("weight", &eventWeight);
+  chain.SetBranchAddress("nHits", &numHits);
+  chain.SetBranchAddress("pixel", pixel);
+  chain.SetBranchAddress("depth", depth);
+  chain.SetBranchAddress("edep", hitEdep);
+  chain.SetBranchAddress("hitWeight", hitWeight);
+  if (hasTruncated) {
+    chain.SetBranchStatus("truncated", true);
+    chain.SetBranchAddress("truncated", &truncated);
+  }
+
+  TFile out(outputFilename.Data(), "recreate");
+  if (out.IsZombie()) {
+    std::cout << "Can not create " << outputFilename << std::endl;
+    return 1;
+  }
+  Double_t edep[NUM_PIXELS], collected[NUM_PIXELS], charge[NUM_PIXELS],
+      charge2[NUM_PIXELS], sci[NUM_PIXELS], channelWeight[NUM_PIXELS];
+  Double_t edepWeightSum[NUM_PIXELS];
+  Int_t numAboveThreshold;
+  TTree *events = new TTree("events", "events digitized by g4redigi");
+  events->Branch("eventID", &eventID, "eventID/L");
+  events->Branch("E0", &gunEnergy, "E0/D");
+  events->Branch("weight", &eventWeight, "weight/D");
+  events->Branch("edep", edep, Form("edep[%d]/D", NUM_PIXELS));
+  events->Branch("collected", collected, Form("collected[%d]/D", NUM_PIXELS));
+  events->Branch("charge", charge, Form("charge[%d]/D", NUM_PIXELS));
+  events->Branch("charge2", charge2, Form("charge2[%d]/D", NUM_PIXELS));
+  events->Branch("sci", sci, Form("sci[%d]/D", NUM_PIXELS));
+  events->Branch("channelWeight", channelWeight,
+                 Form("channelWeight[%d]/D", NUM_PIXELS));
+  events->Branch("numAboveThreshold", &numAboveThreshold,
+                 "numAboveThreshold/I");
+
+  // one per pixel, then the pixel sum, see OutputLayout.hh
+  TH1::SetDefaultSumw2(kTRUE);
+  std::vector<TH1F *> hEdep, hReal, hEdepSci, hRealSci;
+  for (int p = 0; p <= NUM_PIXELS; p++) {
+    hEdep.push_back(BookPixelSpectrum(kEdepSpectrum, p));
+    hReal.push_back(BookPixelSpectrum(kRealSpectrum, p));
+    hEdepSci.push_back(BookPixelSpectrum(kEdepSciSpectrum, p));
+    hRealSci.push_back(BookPixelSpectrum(kRealSciSpectrum, p));
+  }
+
+  std::cout << "Digitizing " << numEntries << " events with "
+            << response.Describe() << std::endl;
+  TRandom3 random;
+  Long64_t lastEventID = -1;
+  Int_t lastTree = -1;
+  Long64_t numTruncated = 0;
+  for (Long64_t entry = 0; entry < numEntries; entry++) {
+    chain.GetEntry(entry);
+    if (truncated) {
+      numTruncated++;
+      if (skipTruncated)
+        continue;
+    }
+    for (int p = 0; p < NUM_PIXELS; p++) {
+      edep[p] = 0;
+      collected[p] = 0;
+      charge[p] = 0;
+      charge2[p] = 0;
+      sci[p] = -1;
+      channelWeight[p] = 0;
+      edepWeightSum[p] = 0;
+    }
+    for (int k = 0; k < numHits && k < MAX_HITS; k++) {
+      int p = pixel[k];
+      if (p < 0 || p >= NUM_PIXELS)
+        continue;
+      double eff = response.GetCollectionEfficiency(depth[k]) *
+                   response.GetNearSurfaceFactor(depth[k]);
+      edep[p] += hitEdep[k];
+      edepWeightSum[p] += hitEdep[k] * hitWeight[k];
+      collected[p] += eff * hitEdep[k];
+    }
+
+    // same order of the random numbers as AnalysisManager::ProcessEvent;
+    // the split copies of an importance biased event are consecutive
+    // entries which share the stream of the event
+    if (entry == 0 || eventID != lastEventID ||
+        chain.GetTreeNumber() != lastTree) {
+      random.SetSeed(DetectorResponse::GetDigitizationSeed(
+          seeds[chain.GetTreeNumber()], eventID));
+    }
+    lastEventID = eventID;
+    lastTree = chain.GetTreeNumber();
+    numAboveThreshold = 0;
+    for (int p = 0; p < NUM_PIXELS; p++) {
+      if (edep[p] <= 0)
+        continue;
+      double w = edepWeightSum[p] / edep[p];
+      channelWeight[p] = w;
+      response.Digitize(collected[p], &random, charge[p], charge2[p]);
+      if (charge2[p] > response.GetThreshold())
+        numAboveThreshold++;
+      sci[p] = GetScienceChannel(charge2[p]);
+      int slots[2] = {p, NUM_PIXELS};
+      for (int s = 0; s < 2; s++) {
+        hEdep[slots[s]]->Fill(edep[p], w);
+        hReal[slots[s]]->Fill(charge2[p], w);
+        hEdepSci[slots[s]]->Fill(edep[p], w);
+        hRealSci[slots[s]]->Fill(charge2[p], w);
+      }
+    }
+    events->Fill();
+  }
+
+  out.cd();
+  events->Write();
+  TNamed parameters("detectorResponse", response.Describe().c_str());
+  parameters.Write();
+  TDirectory *cdhist = out.mkdir("hist");
+  cdhist->cd();
+  for (int p = 0; p <= NUM_PIXELS; p++) {
+    NormalizeScienceSpectrum(hEdepSci[p]);
+    NormalizeScienceSpectrum(hRealSci[p]);
+    hEdep[p]->Write();
+    hReal[p]->Write();
+    hEdepSci[p]->Write();
+    hRealSci[p]->Write();
+  }
+  out.Close();
+  if (numTruncated > 0) {
+    std::cout << numTruncated << " events with more than " << MAX_HITS
+              << " hits were truncated by g4main"
+              << (skipTruncated ? " and skipped" : "") << std::endl;
+  } else if (!hasTruncated) {
+    std::cout << "The inputs do not flag truncated events" << std::endl;
+  }
+  std::cout << "Wrote " << outputFilename << std::endl;
+  return 0;
+}
@@ -0,0 +1,261 @@
+/***************************************************************
+ * g4reproject: detector maps at other distances and orientations
+ * from the inp tree of g4main outputs
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * Everything between the tungsten plate and the detector is vacuum, so
+ * the position and direction of every recorded crossing define a
+ * straight line, which is intersected with each requested plane. One
+ * simulation gives the maps of a whole spacing scan.
+ *
+ * Intersections inside the tungsten plate are rejected; its half depth
+ * is read from the metadata of the inputs unless --min-z is given.
+ *
+ * Only the particles that reached the detector box are in the inp tree;
+ * planes larger than the box, or tilted far out of it, miss the
+ * particles that passed by it.
+ ***************************************************************/
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OutputLayout.hh"
+#include "TChain.h"
+#include "TFile.h"
+#include "TH2F.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TString.h"
+#include "TVector3.h"
+
+// DetectorConstruction, without /det/plate/depth
+const double DEFAULT_PLATE_HALF_DEPTH = 15;
+
+struct Plane {
+  double z, tiltX, tiltY;  // mm, deg, deg
+  TVector3 center, normal, u, v;
+  TH2F *h2;
+};
+
+void Help() {
+  std::cout << "g4reproject: project the inp tree to other detector planes"
+            << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4reproject -o OUTPUT.root --plane Z[,TILTX[,TILTY]] "
+               "[--plane ...] INPUT1.root [INPUT2.root ...]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " --plane Z,TX,TY plane through (0, 0, Z), Z in mm, rotated "
+               "by TX degrees around x then TY degrees around y"
+            << std::endl
+            << " --bins N        bins per axis of the maps, default: 1800"
+            << std::endl
+            << " --range R       maps cover [-R, R] mm, default: 90"
+            << std::endl
+            << " --min-z Z       reject intersections below Z mm, i.e. "
+               "inside the plate, default: the plate half depth in the "
+               "metadata"
+            << std::endl
+            << " Input file names may contain wildcards" << std::endl;
+}
+
+bool ParsePlane(const std::string &spec, Plane &plane) {
+  std::istringstream fields(spec);
+  std::string field;
+  std::vector<double> values;
+  while (std::getline(fields, field, ',')) {
+    char *end;
+    values.push_back(strtod(field.c_str(), &end));
+    if (*end != '\0' || field.empty()) {
+      return false;
+    }
+  }
+  if (values.empty() || values.size() > 3) {
+    return false;
+  }
+  values.resize(3, 0);
+  plane.z = values[0];
+  plane.tiltX = values[1];
+  plane.tiltY = values[2];
+  plane.center.SetXYZ(0, 0, plane.z);
+  plane.normal.SetXYZ(0, 0, 1);
+  plane.u.SetXYZ(1, 0, 0);
+  plane.v.SetXYZ(0, 1, 0);
+  TVector3 *axes[3] = {&plane.normal, &plane.u, &plane.v};
+  for (int i = 0; i < 3; i++) {
+    axes[i]->RotateX(plane.tiltX * M_PI / 180);
+    axes[i]->RotateY(plane.tiltY * M_PI / 180);
+  }
+  return true;
+}
+
+// the plate half depth written by AnalysisManager::CopyMacrosToROOT;
+// older outputs only have it in the macro text when it was changed
+bool ReadPlateHalfDepth(const char *filename, double &halfDepth) {
+  TFile f(filename);
+  TNamed *metadata = f.IsZombie() ? NULL : (TNamed *)f.Get("metadata");
+  if (!metadata)
+    return false;
+  std::string text = metadata->GetTitle();
+  const std::string key = "Plate half depth: ";
+  size_t pos = text.find(key);
+  if (pos != std::string::npos) {
+    halfDepth = atof(text.c_str() + pos + key.size());
+    return true;
+  }
+  if (text.find("/det/plate/depth") != std::string::npos)
+    return false;
+  halfDepth = DEFAULT_PLATE_HALF_DEPTH;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  TString outputFilename = "";
+  std::vector<Plane> planes;
+  std::vector<TString> inputs;
+  int numBins = 1800;
+  double range = 90;
+  double minZ = 0;
+  bool hasMinZ = false;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-o" && hasValue) {
+      outputFilename = argv[++i];
+    } else if (sel == "--plane" && hasValue) {
+      Plane plane;
+      if (!ParsePlane(argv[++i], plane)) {
+        std::cout << "Invalid plane: " << argv[i] << std::endl;
+        return 1;
+      }
+      planes.push_back(plane);
+    } else if (sel == "--bins" && hasValue) {
+      numBins = atoi(argv[++i]);
+    } else if (sel == "--range" && hasValue) {
+      range = atof(argv[++i]);
+    } else if (sel == "--min-z" && hasValue) {
+      minZ = atof(argv[++i]);
+      hasMinZ = true;
+    } else if (sel.BeginsWith("-")) {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    } else {
+      inputs.push_back(sel);
+    }
+  }
+  if (!outputFilename.EndsWith(".root") || planes.empty() || inputs.empty() ||
+      numBins < 1 || range <= 0) {
+    Help();
+    return 1;
+  }
+
+  TChain chain("inp");
+  for (size_t i = 0; i < inputs.size(); i++) {
+    chain.Add(inputs[i].Data());
+  }
+  Long64_t numEntries = chain.GetEntries();
+  if (numEntries <= 0) {
+    std::cout << "No inp entries found in the input files" << std::endl;
+    return 1;
+  }
+  if (!hasMinZ) {
+    TObjArray *files = chain.GetListOfFiles();
+    for (int i = 0; i < files->GetEntries(); i++) {
+      const char *filename = files->At(i)->GetTitle();
+      double halfDepth = 0;
+      if (!ReadPlateHalfDepth(filename, halfDepth)) {
+        std::cout << "No plate half depth in the metadata of " << filename
+                  << ", give it with --min-z" << std::endl;
+        return 1;
+      }
+      if (i > 0 && halfDepth != minZ) {
+        std::cout << "The inputs have different plate depths, give the "
+                     "half depth with --min-z"
+                  << std::endl;
+        return 1;
+      }
+      minZ = halfDepth;
+    }
+  }
+  Double_t pos[3], dir[3];
+  Double_t weight = 1;
+  // only the branches used here are read
+  chain.SetBranchStatus("*", 0);
+  chain.SetBranchStatus("pos", 1);
+  chain.SetBranchStatus("v", 1);
+  chain.SetBranchAddress("pos", pos);
+  chain.SetBranchAddress("v", dir);
+  if (chain.GetBranch("weight")) {
+    chain.SetBranchStatus("weight", 1);
+    chain.SetBranchAddress("weight", &weight);
+  }
+  chain.SetCacheSize(64 * 1024 * 1024);
+  chain.AddBranchToCache("*", kTRUE);
+  chain.StopCacheLearningPhase();
+
+  TFile *f = new TFile(outputFilename.Data(), "recreate");
+  if (f->IsZombie()) {
+    std::cout << "Can not create " << outputFilename << std::endl;
+    return 1;
+  }
+  for (size_t i = 0; i < planes.size(); i++) {
+    Plane &p = planes[i];
+    p.h2 = new TH2F(
+        Form("h2xy_%d", (int)i),
+        Form("Locations of hits, plane at z = %g mm, tilt (%g, %g) deg; "
+             "X (mm); Y (mm)",
+             p.z, p.tiltX, p.tiltY),
+        numBins, -range, range, numBins, -range, range);
+  }
+
+  std::vector<Long64_t> numRejected(planes.size(), 0);
+  for (Long64_t entry = 0; entry < numEntries; entry++) {
+    chain.GetEntry(entry);
+    TVector3 r0(pos[0], pos[1] + PY_ORIGIN, pos[2] + PZ_ORIGIN);
+    TVector3 d(dir[0], dir[1], dir[2]);
+    for (size_t i = 0; i < planes.size(); i++) {
+      Plane &p = planes[i];
+      double dn = d.Dot(p.normal);
+      if (dn <= 0) {
+        // parallel to the plane or moving away from it
+        numRejected[i]++;
+        continue;
+      }
+      // may be negative, the line is then followed back towards the plate
+      double t = (p.center - r0).Dot(p.normal) / dn;
+      TVector3 hit = r0 + t * d;
+      if (hit.Z() < minZ) {
+        numRejected[i]++;
+        continue;
+      }
+      TVector3 local = hit - p.center;
+      p.h2->Fill(local.Dot(p.u), local.Dot(p.v), weight);
+    }
+  }
+
+  std::ostringstream summary;
+  summary << "g4reproject of " << numEntries << " inp entries, min z = "
+          << minZ << " mm" << std::endl;
+  for (size_t i = 0; i < planes.size(); i++) {
+    summary << planes[i].h2->GetName() << ": z = " << planes[i].z
+            << " mm, tilt = (" << planes[i].tiltX << ", " << planes[i].tiltY
+            << ") deg, rejected " << numRejected[i] << std::endl;
+    planes[i].h2->Write();
+  }
+  TNamed meta("metadata", summary.str().c_str());
+  meta.Write();
+  f->Close();
+  delete f;
+  std::cout << summary.str();
+  return 0;
+}
@@ -0,0 +1,219 @@
+/***************************************************************
+ * g4rmf: OGIP response files from the matrices of g4main --response
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * Writes NAME.rmf (MATRIX and EBOUNDS extensions) and NAME.arf
+ * (SPECRESP), following OGIP CAL/GEN/92-002. The matrix rows are the
+ * counts of each photon energy bin divided by the primaries of that bin,
+ * split into the redistribution (rows normalized to 1) and the effective
+ * area (beam area x detection efficiency). Only the non-zero channel
+ * groups of each row are stored (N_GRP, F_CHAN, N_CHAN, MATRIX), so the
+ * file size follows the non-zero content of the matrix.
+ ***************************************************************/
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "FitsTable.hh"
+#include "TFile.h"
+#include "TH1F.h"
+#include "TH2F.h"
+#include "TString.h"
+
+void Help() {
+  std::cout << "g4rmf: write OGIP RMF and ARF files from g4main --response "
+               "outputs"
+            << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4rmf -i INPUT.root -o NAME --area CM2 [OPTIONS]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " --area CM2        area of the source plane in cm2"
+            << std::endl
+            << " --pixel N         pixel N instead of the sum of all pixels"
+            << std::endl
+            << " --deposited       deposited instead of recorded energies"
+            << std::endl
+            << " --min-prob P      drop normalized matrix elements below P, "
+               "default: 0"
+            << std::endl
+            << " --telescope NAME  TELESCOP keyword, default: UNKNOWN"
+            << std::endl
+            << " --instrument NAME INSTRUME keyword, default: UNKNOWN"
+            << std::endl
+            << " Writes NAME.rmf and NAME.arf" << std::endl;
+}
+
+// keywords shared by all OGIP response extensions
+void AddOgipKeys(FitsTable &table, const TString &telescope,
+                 const TString &instrument, const char *hduclas2) {
+  table.AddKey("HDUCLASS", "OGIP", "format conforms to OGIP standard");
+  table.AddKey("HDUCLAS1", "RESPONSE", "dataset relates to spectral response");
+  table.AddKey("HDUCLAS2", hduclas2, "");
+  table.AddKey("TELESCOP", telescope.Data(), "");
+  table.AddKey("INSTRUME", instrument.Data(), "");
+  table.AddKey("FILTER", "NONE", "");
+  table.AddKey("CHANTYPE", "PI", "channel type");
+  table.AddKey("CREATOR", "g4rmf", "");
+}
+
+int main(int argc, char **argv) {
+  TString inputFilename = "";
+  TString outputName = "";
+  TString pixel = "Sum";
+  TString kind = "Real";
+  TString telescope = "UNKNOWN";
+  TString instrument = "UNKNOWN";
+  double area = 0;
+  double minProb = 0;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-i" && hasValue) {
+      inputFilename = argv[++i];
+    } else if (sel == "-o" && hasValue) {
+      outputName = argv[++i];
+    } else if (sel == "--area" && hasValue) {
+      area = atof(argv[++i]);
+    } else if (sel == "--pixel" && hasValue) {
+      pixel = argv[++i];
+    } else if (sel == "--deposited") {
+      kind = "Edep";
+    } else if (sel == "--min-prob" && hasValue) {
+      minProb = atof(argv[++i]);
+    } else if (sel == "--telescope" && hasValue) {
+      telescope = argv[++i];
+    } else if (sel == "--instrument" && hasValue) {
+      instrument = argv[++i];
+    } else {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    }
+  }
+  if (inputFilename == "" || outputName == "" || area <= 0) {
+    Help();
+    return 1;
+  }
+
+  TFile *f = TFile::Open(inputFilename.Data());
+  if (!f || f->IsZombie()) {
+    std::cout << "Can not open " << inputFilename << std::endl;
+    return 1;
+  }
+  TString matrixName = Form("response/hResponse%s%s", kind.Data(), pixel.Data());
+  TH2F *matrix = (TH2F *)f->Get(matrixName.Data());
+  TH1F *primaries = (TH1F *)f->Get("response/hResponseE0");
+  if (!matrix || !primaries) {
+    std::cout << "No " << matrixName << " or response/hResponseE0 in "
+              << inputFilename << ", was g4main run with --response?"
+              << std::endl;
+    return 1;
+  }
+
+  int numEnergies = matrix->GetNbinsX();
+  int numChannels = matrix->GetNbinsY();
+  std::vector<float> energyLow(numEnergies), energyHigh(numEnergies);
+  std::vector<float> effectiveArea(numEnergies);
+  std::vector<int> numGroups(numEnergies);
+  std::vector<std::vector<int> > firstChannels(numEnergies);
+  std::vector<std::vector<int> > numGroupChannels(numEnergies);
+  std::vector<std::vector<float> > elements(numEnergies);
+  long numElements = 0;
+
+  for (int i = 0; i < numEnergies; i++) {
+    energyLow[i] = matrix->GetXaxis()->GetBinLowEdge(i + 1);
+    energyHigh[i] = matrix->GetXaxis()->GetBinUpEdge(i + 1);
+    double numPrimaries = primaries->GetBinContent(i + 1);
+    std::vector<double> row(numChannels, 0);
+    double efficiency = 0;
+    for (int j = 0; j < numChannels; j++) {
+      if (numPrimaries > 0)
+        row[j] = matrix->GetBinContent(i + 1, j + 1) / numPrimaries;
+      efficiency += row[j];
+    }
+    // the threshold applies to the redistribution, the dropped elements
+    // do not change the efficiency
+    effectiveArea[i] = area * efficiency;
+    numGroups[i] = 0;
+    if (efficiency <= 0)
+      continue;
+    for (int j = 0; j < numChannels; j++) {
+      row[j] /= efficiency;
+      if (row[j] < minProb)
+        row[j] = 0;
+    }
+    // contiguous runs of non-zero channels, channels start at 1
+    for (int j = 0; j < numChannels; j++) {
+      if (row[j] <= 0)
+        continue;
+      if (j == 0 || row[j - 1] <= 0) {
+        firstChannels[i].push_back(j + 1);
+        numGroupChannels[i].push_back(0);
+        numGroups[i]++;
+      }
+      numGroupChannels[i].back()++;
+      elements[i].push_back(row[j]);
+    }
+    numElements += elements[i].size();
+  }
+
+  FitsTable matrixTable("MATRIX", numEnergies);
+  matrixTable.AddColumn("ENERG_LO", "keV", energyLow);
+  matrixTable.AddColumn("ENERG_HI", "keV", energyHigh);
+  matrixTable.AddColumn("N_GRP", "", numGroups);
+  matrixTable.AddColumn("F_CHAN", "", firstChannels);
+  matrixTable.AddColumn("N_CHAN", "", numGroupChannels);
+  matrixTable.AddColumn("MATRIX", "", elements);
+  AddOgipKeys(matrixTable, telescope, instrument, "RSP_MATRIX");
+  matrixTable.AddKey("HDUCLAS3", "REDIST", "photon redistribution matrix");
+  matrixTable.AddKey("HDUVERS", "1.3.0", "");
+  matrixTable.AddKey("DETCHANS", (long)numChannels, "number of channels");
+  matrixTable.AddKey("LO_THRES", minProb, "lower threshold of the elements");
+  matrixTable.AddKey("TLMIN4", 1L, "first channel number");
+  matrixTable.AddKey("TLMAX4", (long)numChannels, "last channel number");
+
+  std::vector<int> channels(numChannels);
+  std::vector<float> channelLow(numChannels), channelHigh(numChannels);
+  for (int j = 0; j < numChannels; j++) {
+    channels[j] = j + 1;
+    channelLow[j] = matrix->GetYaxis()->GetBinLowEdge(j + 1);
+    channelHigh[j] = matrix->GetYaxis()->GetBinUpEdge(j + 1);
+  }
+  FitsTable eboundsTable("EBOUNDS", numChannels);
+  eboundsTable.AddColumn("CHANNEL", "", channels);
+  eboundsTable.AddColumn("E_MIN", "keV", channelLow);
+  eboundsTable.AddColumn("E_MAX", "keV", channelHigh);
+  AddOgipKeys(eboundsTable, telescope, instrument, "EBOUNDS");
+  eboundsTable.AddKey("HDUVERS", "1.2.0", "");
+  eboundsTable.AddKey("DETCHANS", (long)numChannels, "number of channels");
+
+  FitsTable arfTable("SPECRESP", numEnergies);
+  arfTable.AddColumn("ENERG_LO", "keV", energyLow);
+  arfTable.AddColumn("ENERG_HI", "keV", energyHigh);
+  arfTable.AddColumn("SPECRESP", "cm**2", effectiveArea);
+  AddOgipKeys(arfTable, telescope, instrument, "SPECRESP");
+  arfTable.AddKey("HDUVERS", "1.1.0", "");
+
+  std::vector<FitsTable> rmf;
+  rmf.push_back(matrixTable);
+  rmf.push_back(eboundsTable);
+  std::vector<FitsTable> arf(1, arfTable);
+  TString rmfName = outputName + ".rmf";
+  TString arfName = outputName + ".arf";
+  if (!FitsTable::WriteFile(rmfName.Data(), rmf) ||
+      !FitsTable::WriteFile(arfName.Data(), arf)) {
+    return 1;
+  }
+  std::cout << "Wrote " << rmfName << " (" << numElements << " of "
+            << (long)numEnergies * numChannels << " elements stored) and "
+            << arfName << std::endl;
+  delete f;
+  return 0;
+}
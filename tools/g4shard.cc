@@ -0,0 +1,238 @@
+/***************************************************************
+ * g4shard: split the /run/beamOn of a macro across several local
+ * g4main processes and merge their outputs
+ * Author  : Hualin Xiao
+ * Date    : Jun, 2025
+ * Version : 1.10
+ *
+ * Every shard runs the same macro with its share of the events, the
+ * same seed and its own --event-offset, so that the merged result is
+ * identical to the one of a single process.
+ ***************************************************************/
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OutputMerger.hh"
+#include "TString.h"
+#include "TSystem.h"
+
+void Help() {
+  std::cout << "g4shard: run a g4main macro in several processes" << std::endl;
+  std::cout << "Usage:" << std::endl
+            << "./g4shard -n N -m run.mac -o OUTPUT.root [OPTIONS] [-- "
+               "g4main options]"
+            << std::endl;
+  std::cout << "Options:" << std::endl
+            << " -n N            number of processes" << std::endl
+            << " --seed S        run seed shared by all shards, default: "
+               "current time"
+            << std::endl
+            << " --g4main PATH   g4main executable, default: ./g4main"
+            << std::endl
+            << " --no-merge      keep the shard outputs, don't merge them"
+            << std::endl
+            << " --keep          keep the shard outputs, macros and logs "
+               "after merging"
+            << std::endl
+            << " The shard outputs, macros and logs (OUTPUT_shardN.*) are "
+               "removed after a successful merge, and kept when a shard or "
+               "the merge fails"
+            << std::endl
+            << " Options after -- are passed to every g4main process"
+            << std::endl;
+}
+
+// reads the macro, returns the number of events of its only /run/beamOn
+long ReadMacro(const TString &macFilename, std::vector<std::string> &lines,
+               int &beamOnLine) {
+  std::ifstream infile(macFilename.Data());
+  if (!infile.good()) {
+    std::cout << "Can not open the macro file " << macFilename << std::endl;
+    return -1;
+  }
+  long numEvents = -1;
+  beamOnLine = -1;
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::istringstream words(line);
+    std::string cmd;
+    words >> cmd;
+    if (cmd == "/run/beamOn") {
+      if (beamOnLine >= 0) {
+        std::cout << "Only macros with a single /run/beamOn can be split"
+                  << std::endl;
+        return -1;
+      }
+      words >> numEvents;
+      beamOnLine = lines.size();
+    }
+    lines.push_back(line);
+  }
+  if (beamOnLine < 0 || numEvents <= 0) {
+    std::cout << "No /run/beamOn found in " << macFilename << std::endl;
+    return -1;
+  }
+  return numEvents;
+}
+
+pid_t StartShard(const std::vector<std::string> &args, const TString &log) {
+  pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+  int fd = open(log.Data(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+  }
+  std::vector<char *> argv;
+  for (size_t i = 0; i < args.size(); i++) {
+    argv.push_back(const_cast<char *>(args[i].c_str()));
+  }
+  argv.push_back(NULL);
+  execvp(argv[0], &argv[0]);
+  std::cerr << "Can not execute " << args[0] << std::endl;
+  _exit(127);
+}
+
+int main(int argc, char **argv) {
+  int numShards = 0;
+  long seed = time(NULL);
+  TString macFilename = "";
+  TString outputFilename = "";
+  TString g4main = "./g4main";
+  bool merge = true;
+  bool keep = false;
+  std::vector<std::string> extraArgs;
+
+  for (int i = 1; i < argc; i++) {
+    TString sel = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (sel == "-h" || sel == "--help") {
+      Help();
+      return 0;
+    } else if (sel == "-n" && hasValue) {
+      numShards = atoi(argv[++i]);
+    } else if (sel == "-m" && hasValue) {
+      macFilename = argv[++i];
+    } else if (sel == "-o" && hasValue) {
+      outputFilename = argv[++i];
+    } else if (sel == "--seed" && hasValue) {
+      seed = atol(argv[++i]);
+    } else if (sel == "--g4main" && hasValue) {
+      g4main = argv[++i];
+    } else if (sel == "--no-merge") {
+      merge = false;
+    } else if (sel == "--keep") {
+      keep = true;
+    } else if (sel == "--") {
+      for (i++; i < argc; i++) {
+        extraArgs.push_back(argv[i]);
+      }
+    } else {
+      std::cout << "Can not understand option :" << sel << std::endl;
+      Help();
+      return 1;
+    }
+  }
+  if (numShards < 1 || !macFilename.EndsWith(".mac") ||
+      !outputFilename.EndsWith(".root")) {
+    Help();
+    return 1;
+  }
+
+  std::vector<std::string> lines;
+  int beamOnLine;
+  long numEvents = ReadMacro(macFilename, lines, beamOnLine);
+  if (numEvents < 0) {
+    return 1;
+  }
+  if (numShards > numEvents) {
+    numShards = numEvents;
+  }
+
+  TString baseName = outputFilename;
+  baseName.Remove(baseName.Length() - 5);
+  std::vector<TString> shardFiles, shardMacros, shardLogs;
+  std::vector<pid_t> pids;
+  long offset = 0;
+  for (int i = 0; i < numShards; i++) {
+    long shardEvents = numEvents / numShards + (i < numEvents % numShards);
+    TString shardMacro = Form("%s_shard%d.mac", baseName.Data(), i);
+    TString shardOutput = Form("%s_shard%d.root", baseName.Data(), i);
+    TString shardLog = Form("%s_shard%d.log", baseName.Data(), i);
+
+    std::ofstream mac(shardMacro.Data());
+    for (size_t j = 0; j < lines.size(); j++) {
+      if ((int)j == beamOnLine) {
+        mac << "/run/beamOn " << shardEvents << std::endl;
+      } else {
+        mac << lines[j] << std::endl;
+      }
+    }
+    mac.close();
+
+    std::vector<std::string> args;
+    args.push_back(g4main.Data());
+    args.push_back("-m");
+    args.push_back(shardMacro.Data());
+    args.push_back("-o");
+    args.push_back(shardOutput.Data());
+    args.push_back("--seed");
+    args.push_back(Form("%ld", seed));
+    args.push_back("--event-offset");
+    args.push_back(Form("%ld", offset));
+    args.insert(args.end(), extraArgs.begin(), extraArgs.end());
+
+    std::cout << "Shard " << i << ": events " << offset << " - "
+              << offset + shardEvents - 1 << ", log: " << shardLog
+              << std::endl;
+    pid_t pid = StartShard(args, shardLog);
+    if (pid < 0) {
+      std::cout << "Can not start shard " << i << std::endl;
+      return 1;
+    }
+    pids.push_back(pid);
+    shardFiles.push_back(shardOutput);
+    shardMacros.push_back(shardMacro);
+    shardLogs.push_back(shardLog);
+    offset += shardEvents;
+  }
+
+  int numFailed = 0;
+  for (size_t i = 0; i < pids.size(); i++) {
+    int status = 0;
+    waitpid(pids[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cout << "Shard " << i << " failed, see its log" << std::endl;
+      numFailed++;
+    }
+  }
+  if (numFailed > 0) {
+    return 1;
+  }
+  if (!merge) {
+    return 0;
+  }
+  if (!MergeOutputFiles(shardFiles, outputFilename)) {
+    return 1;
+  }
+  if (!keep) {
+    for (size_t i = 0; i < shardFiles.size(); i++) {
+      gSystem->Unlink(shardFiles[i].Data());
+      gSystem->Unlink(shardMacros[i].Data());
+      gSystem->Unlink(shardLogs[i].Data());
+    }
+  }
+  return 0;
+}